@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include "game_of_life.h"
+#include "hashlife.h"
+#include "life_rules.h"
+
+// Microbenchmark dos kernels, sem o servidor HTTP: chama os run_size_*
+// diretamente, varrendo tamanhos e números de threads, e reporta GCUPS
+// (bilhões de atualizações de célula por segundo de comp) e a banda de
+// memória estimada. Os resultados podem ser gravados em JSON e comparados
+// com um baseline gravado antes, para acusar regressões.
+//
+// Uso: ./bench [-k variantes] [-p POWMIN-POWMAX] [-t threads] [-r reps]
+//              [-o saida.json] [-b baseline.json] [-T tolerancia%] [-R regra]
+// Variantes: scalar, sse4, avx2, avx512 (tabuleiro de int com o kernel
+// escolhido), packed, tiled, active, hashlife, cycle; o padrão são todas as
+// suportadas pela CPU. Ex.: ./bench -k avx2,packed -p 8-11 -t 1,2,4
+// Com packed na lista, antes das medições o packed é conferido célula a
+// célula contra o kernel de int em tam=63 e tam=127.
+// Na HashLife o GCUPS é efetivo: células equivalentes às do tabuleiro
+// denso, não nós efetivamente calculados; o mesmo vale para o cycle.
+// Com -R (ex.: -R B36/S23) as variantes de kernel usam os kernels
+// especializados da regra e aparecem como "avx2:B36/S23"; as demais
+// variantes só rodam B3/S23 e são recusadas.
+
+#define BENCH_MAX_VARIANTS 16
+#define BENCH_MAX_THREADS 16
+#define BENCH_MAX_RESULTS 1024
+#define BENCH_DEFAULT_POWMIN 8
+#define BENCH_DEFAULT_POWMAX 11
+#define BENCH_DEFAULT_REPS 3
+#define BENCH_DEFAULT_TOLERANCE 10.0   // queda percentual aceita
+#define BENCH_TILE 256                 // mesma geometria padrão do engine HTTP
+#define BENCH_TBLOCK 4
+
+typedef struct {
+    const char* name;
+    const vida_kernel_t* kernel;   // kernel usado (NULL em packed, tiled, hashlife e cycle)
+} variant_t;
+
+typedef struct {
+    char variant[32];
+    char kernel[32];
+    int tam, threads;
+    double comp;        // melhor das repetições
+    double gcups;
+    double gbps;        // < 0 quando a estimativa não se aplica (hashlife, cycle)
+} bench_result_t;
+
+static variant_t variantes[BENCH_MAX_VARIANTS];
+static int nvariantes = 0;
+static const vida_regra_t* regra;
+
+static const vida_kernel_t* kernel_por_nome(const char* name) {
+    int k;
+    for (k = 0; k < num_vida_kernels; k++)
+        if (strcmp(vida_kernels[k].name, name) == 0)
+            return &vida_kernels[k];
+    return NULL;
+}
+
+// Adiciona uma variante; o active roda com o kernel escolhido por
+// select_vida_kernel nos trechos densos
+static int adicionar_variante(const char* name) {
+    const vida_kernel_t* k = kernel_por_nome(name);
+    static const char* modos[] = { "packed", "tiled", "active", "hashlife", "cycle" };
+    int m;
+
+    if (nvariantes == BENCH_MAX_VARIANTS) return 0;
+    if (k) {
+        if (!kernel_supported(k)) {
+            printf("AVISO: kernel %s não suportado pela CPU, ignorado\n", name);
+            return 1;
+        }
+        variantes[nvariantes].name = k->name;
+        variantes[nvariantes++].kernel = k;
+        return 1;
+    }
+    for (m = 0; m < 5; m++) {
+        if (strcmp(name, modos[m]) == 0) {
+            variantes[nvariantes].name = modos[m];
+            variantes[nvariantes++].kernel = strcmp(name, "active") == 0 ? vida_kernel : NULL;
+            return 1;
+        }
+    }
+    fprintf(stderr, "Variante desconhecida: %s\n", name);
+    return 0;
+}
+
+static int executar(const variant_t* v, int tam, size_result_t* r) {
+    if (v->kernel) vida_kernel = v->kernel;
+    if (strcmp(v->name, "packed") == 0)
+        return run_size_packed(tam, r);
+    if (strcmp(v->name, "tiled") == 0)
+        return run_size_tiled(tam, BENCH_TILE, BENCH_TBLOCK, r);
+    if (strcmp(v->name, "active") == 0)
+        return run_size_active(tam, r);
+    if (strcmp(v->name, "hashlife") == 0) {
+        // Contexto novo a cada repetição: a memorização deixaria as
+        // seguintes quase instantâneas
+        hashlife_t* hl = hashlife_create(HASHLIFE_DEFAULT_MAX_NODES);
+        int ok = hl && run_size_hashlife(hl, tam, r);
+        hashlife_destroy(hl);
+        return ok;
+    }
+    if (strcmp(v->name, "cycle") == 0) {
+        cycle_info_t info;
+        return run_size_cycle(tam, r, &info);
+    }
+    if (regra != VIDA_REGRA_CONWAY)
+        return run_size_rule(tam, regra, r);
+    return run_size_int(tam, r);
+}
+
+// Bytes de memória por geração: ler um tabuleiro e escrever o outro. O
+// tiled só vai à memória uma vez a cada tblock gerações e o active só
+// nos blocos recalculados (r->work); HashLife e cycle não têm estimativa.
+static double bytes_por_geracao(const variant_t* v, int tam, const size_result_t* r) {
+    double lado = tam + 2;
+    if (strcmp(v->name, "hashlife") == 0 || strcmp(v->name, "cycle") == 0) return -1.0;
+    if (strcmp(v->name, "packed") == 0) return 2.0 * lado * packed_words(tam) * sizeof(uint64_t);
+    if (strcmp(v->name, "tiled") == 0) return 2.0 * lado * lado * sizeof(int) / BENCH_TBLOCK;
+    if (strcmp(v->name, "active") == 0) return 2.0 * lado * lado * sizeof(int) * r->work;
+    return 2.0 * lado * lado * sizeof(int);
+}
+
+// Tamanhos fora de potência de 2 em que a borda direita cai no início de
+// uma palavra do packed (tam%64 == 63): o packed tem de bater célula a
+// célula com o kernel de int, num glider e numa sopa aleatória
+static int conferir_packed(void) {
+    static const int tams[] = { 63, 127 };
+    int k;
+
+    for (k = 0; k < 2; k++) {
+        const int tam = tams[k], words = packed_words(tam);
+        size_result_t ri, rp;
+        int *a = calloc((size_t)(tam+2)*(tam+2), sizeof(int));
+        int *b = calloc((size_t)(tam+2)*(tam+2), sizeof(int));
+        uint64_t *pa = calloc((size_t)(tam+2)*words, sizeof(uint64_t));
+        uint64_t *pb = calloc((size_t)(tam+2)*words, sizeof(uint64_t));
+        uint64_t semente = 0x9E3779B97F4A7C15ULL;
+        int i, j, g, ok = a && b && pa && pb;
+
+        if (ok && (!run_size_int(tam, &ri) || !run_size_packed(tam, &rp) || ri.correct != rp.correct)) {
+            fprintf(stderr, "packed diverge do int no glider: tam=%d\n", tam);
+            ok = 0;
+        }
+        for (i = 1; ok && i <= tam; i++)
+            for (j = 1; j <= tam; j++) {
+                semente = semente * 6364136223846793005ULL + 1442695040888963407ULL;
+                if ((semente >> 33) % 3 == 0) {
+                    a[ind2d(i,j)] = 1;
+                    packed_set(pa, tam, i, j);
+                }
+            }
+        for (g = 0; ok && g < 4*(tam-3); g++) {
+            int *t = a; uint64_t *pt = pa;
+            UmaVida(a, b, tam);
+            UmaVidaPacked(pa, pb, tam);
+            a = b; b = t; pa = pb; pb = pt;
+            for (i = 0; ok && i <= tam+1; i++)
+                for (j = 0; j <= tam+1; j++)
+                    if (a[ind2d(i,j)] != packed_get(pa, tam, i, j)) {
+                        fprintf(stderr, "packed diverge do int: tam=%d geração %d célula (%d,%d)\n",
+                                tam, g+1, i, j);
+                        ok = 0;
+                        break;
+                    }
+        }
+        free(a); free(b); free(pa); free(pb);
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+static int parse_lista_int(char* arg, int* out, int max) {
+    int n = 0;
+    char* tok = strtok(arg, ",");
+    while (tok && n < max) {
+        if (atoi(tok) > 0) out[n++] = atoi(tok);
+        tok = strtok(NULL, ",");
+    }
+    return n;
+}
+
+static void gravar_json(const char* path, const bench_result_t* res, int n) {
+    FILE* f = fopen(path, "w");
+    int k;
+    if (!f) {
+        perror("Erro ao gravar resultados");
+        return;
+    }
+    // Um resultado por linha, para que o baseline seja lido sem um parser JSON
+    fprintf(f, "{\"results\":[\n");
+    for (k = 0; k < n; k++)
+        fprintf(f, "{\"variant\":\"%s\",\"kernel\":\"%s\",\"tam\":%d,\"threads\":%d,"
+                "\"comp\":%.7f,\"gcups\":%.4f,\"gbps\":%.4f}%s\n",
+                res[k].variant, res[k].kernel, res[k].tam, res[k].threads,
+                res[k].comp, res[k].gcups, res[k].gbps, k + 1 < n ? "," : "");
+    fprintf(f, "]}\n");
+    fclose(f);
+    printf("Resultados gravados em %s\n", path);
+}
+
+// Compara com o baseline; retorna o número de regressões
+static int comparar_baseline(const char* path, const bench_result_t* res, int n, double tol) {
+    char line[512];
+    int regressoes = 0, comparados = 0, k;
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror("Erro ao abrir baseline");
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char variant[32], kernel[32];
+        int tam, threads;
+        double comp, gcups;
+        if (sscanf(line, "{\"variant\":\"%31[^\"]\",\"kernel\":\"%31[^\"]\",\"tam\":%d,\"threads\":%d,"
+                   "\"comp\":%lf,\"gcups\":%lf", variant, kernel, &tam, &threads, &comp, &gcups) != 6)
+            continue;
+        for (k = 0; k < n; k++) {
+            if (strcmp(res[k].variant, variant) != 0 || strcmp(res[k].kernel, kernel) != 0 ||
+                res[k].tam != tam || res[k].threads != threads)
+                continue;
+            double delta = gcups > 0 ? 100.0 * (res[k].gcups - gcups) / gcups : 0.0;
+            comparados++;
+            if (delta < -tol) {
+                regressoes++;
+                printf("REGRESSÃO: %s/%s tam=%d threads=%d: %.4f -> %.4f GCUPS (%.1f%%)\n",
+                       variant, kernel, tam, threads, gcups, res[k].gcups, delta);
+            }
+        }
+    }
+    fclose(f);
+    printf("Baseline %s: %d resultados comparados, %d regressões (tolerância %.1f%%)\n",
+           path, comparados, regressoes, tol);
+    return regressoes;
+}
+
+int main(int argc, char* argv[]) {
+    int powmin = BENCH_DEFAULT_POWMIN, powmax = BENCH_DEFAULT_POWMAX;
+    int reps = BENCH_DEFAULT_REPS;
+    int threads[BENCH_MAX_THREADS], nthreads = 0;
+    double tol = BENCH_DEFAULT_TOLERANCE;
+    const char *saida = NULL, *baseline = NULL, *rulestring = NULL;
+    char* lista_variantes = NULL;
+    static bench_result_t res[BENCH_MAX_RESULTS];
+    int nres = 0, opt, v, t, pow, k;
+
+    while ((opt = getopt(argc, argv, "k:p:t:r:o:b:T:R:")) != -1) {
+        switch (opt) {
+            case 'k': lista_variantes = optarg; break;
+            case 'p':
+                if (sscanf(optarg, "%d-%d", &powmin, &powmax) == 1) powmax = powmin;
+                break;
+            case 't': nthreads = parse_lista_int(optarg, threads, BENCH_MAX_THREADS); break;
+            case 'r': reps = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+            case 'o': saida = optarg; break;
+            case 'b': baseline = optarg; break;
+            case 'T': tol = atof(optarg); break;
+            case 'R': rulestring = optarg; break;
+            default:
+                fprintf(stderr, "Uso: %s [-k variantes] [-p POWMIN-POWMAX] [-t threads] [-r reps] "
+                        "[-o saida.json] [-b baseline.json] [-T tolerancia%%] [-R regra]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (powmin < 3 || powmax > 15 || powmin > powmax) {
+        fprintf(stderr, "POWMIN deve estar entre 3-15 e POWMIN <= POWMAX\n");
+        return 2;
+    }
+
+    select_vida_kernel();
+    vida_regras_init();
+    regra = rulestring ? vida_regra_parse(rulestring) : VIDA_REGRA_CONWAY;
+    if (!regra) {
+        char regras[384];
+        vida_regras_list(regras, sizeof(regras));
+        fprintf(stderr, "Regra %s sem kernels; suportadas: %s\n", rulestring, regras);
+        return 2;
+    }
+    if (regra != VIDA_REGRA_CONWAY && !lista_variantes) {
+        // Só as variantes de kernel têm versões para outras regras
+        for (k = 0; k < num_vida_kernels; k++)
+            if (kernel_supported(&vida_kernels[k]))
+                adicionar_variante(vida_kernels[k].name);
+    } else if (lista_variantes) {
+        char* tok = strtok(lista_variantes, ",");
+        while (tok) {
+            if (!adicionar_variante(tok)) return 2;
+            tok = strtok(NULL, ",");
+        }
+        // packed, tiled, active, hashlife e cycle só rodam B3/S23
+        for (v = 0; v < nvariantes && regra != VIDA_REGRA_CONWAY; v++)
+            if (!kernel_por_nome(variantes[v].name)) {
+                fprintf(stderr, "Variante %s só roda B3/S23; com -R %s use variantes de kernel\n",
+                        variantes[v].name, regra->name);
+                return 2;
+            }
+    } else {
+        for (k = 0; k < num_vida_kernels; k++)
+            if (kernel_supported(&vida_kernels[k]))
+                adicionar_variante(vida_kernels[k].name);
+        adicionar_variante("packed");
+        adicionar_variante("tiled");
+        adicionar_variante("active");
+        adicionar_variante("hashlife");
+        adicionar_variante("cycle");
+    }
+    for (v = 0; v < nvariantes; v++)
+        if (strcmp(variantes[v].name, "packed") == 0 && !conferir_packed())
+            return 1;
+    if (nthreads == 0) {
+        threads[nthreads++] = 1;
+        if (omp_get_max_threads() > 1) threads[nthreads++] = omp_get_max_threads();
+    }
+
+    printf("%-9s %-7s %6s %7s %12s %9s %8s\n",
+           "variante", "kernel", "tam", "threads", "comp(s)", "GCUPS", "GB/s");
+    for (v = 0; v < nvariantes; v++) {
+        for (t = 0; t < nthreads; t++) {
+            omp_set_num_threads(threads[t]);
+            for (pow = powmin; pow <= powmax && nres < BENCH_MAX_RESULTS; pow++) {
+                int tam = 1 << pow;
+                size_result_t r, melhor = { 0 };
+                double melhor_comp = -1.0;
+
+                for (k = 0; k < reps; k++) {
+                    if (!executar(&variantes[v], tam, &r)) {
+                        fprintf(stderr, "Falha na alocação para tam=%d\n", tam);
+                        return 1;
+                    }
+                    if (r.correct == 0) {
+                        fprintf(stderr, "Resultado ERRADO: %s tam=%d\n", variantes[v].name, tam);
+                        return 1;
+                    }
+                    if (melhor_comp < 0 || r.comp < melhor_comp) {
+                        melhor_comp = r.comp;
+                        melhor = r;
+                    }
+                }
+
+                // 2*(tam-3) pares de gerações sobre tam*tam células
+                double gens = 4.0 * (tam - 3);
+                double bytes = bytes_por_geracao(&variantes[v], tam, &melhor);
+                bench_result_t* b = &res[nres++];
+                if (regra != VIDA_REGRA_CONWAY)
+                    snprintf(b->variant, sizeof(b->variant), "%s:%s", variantes[v].name, regra->name);
+                else
+                    snprintf(b->variant, sizeof(b->variant), "%s", variantes[v].name);
+                snprintf(b->kernel, sizeof(b->kernel), "%s",
+                         variantes[v].kernel ? variantes[v].kernel->name : "-");
+                b->tam = tam;
+                b->threads = threads[t];
+                b->comp = melhor_comp;
+                b->gcups = melhor_comp > 0 ? gens * tam * tam / melhor_comp / 1e9 : 0.0;
+                b->gbps = bytes >= 0 && melhor_comp > 0 ? gens * bytes / melhor_comp / 1e9 : -1.0;
+                printf("%-9s %-7s %6d %7d %12.7f %9.4f ", b->variant, b->kernel, tam,
+                       b->threads, b->comp, b->gcups);
+                if (b->gbps >= 0) printf("%8.3f\n", b->gbps);
+                else printf("%8s\n", "-");
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (saida) gravar_json(saida, res, nres);
+    if (baseline && comparar_baseline(baseline, res, nres, tol) > 0)
+        return 1;
+    return 0;
+}
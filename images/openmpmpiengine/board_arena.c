@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <omp.h>
+#include "board_arena.h"
+
+typedef struct {
+    void* p;
+    size_t cap;             // bytes alocados (múltiplo de ARENA_ALIGN)
+    size_t rows, row_bytes; // formato do uso atual
+    size_t dirty;           // bytes iniciais escritos desde a última zerada
+    int in_use;
+} arena_slot_t;
+
+// Slot reservado por um board_alloc que está alocando fora do mutex
+#define SLOT_RESERVADO ((void*)-1)
+
+static arena_slot_t slots[ARENA_MAX_BUFFERS];
+static size_t arena_bytes = 0;
+static unsigned long arena_reuses = 0, arena_allocs = 0;
+static pthread_mutex_t arena_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Zera os 'bytes' iniciais em faixas de 'row_bytes', em paralelo com a
+// mesma divisão do laço de cálculo
+static void zerar_linhas(char* p, size_t bytes, size_t row_bytes) {
+    long i, rows = (long)((bytes + row_bytes - 1) / row_bytes);
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < rows; i++) {
+        size_t inicio = (size_t)i*row_bytes;
+        memset(p + inicio, 0, bytes - inicio < row_bytes ? bytes - inicio : row_bytes);
+    }
+}
+
+static size_t arena_max_bytes(void) {
+    const char* env = getenv("BOARD_ARENA_MAX_MB");
+    long mb = env ? atol(env) : ARENA_DEFAULT_MAX_MB;
+    return (size_t)(mb > 0 ? mb : 0) << 20;
+}
+
+void* board_alloc(size_t rows, size_t row_bytes) {
+    size_t need = rows * row_bytes, cap;
+    int k, best = -1, livre = -1;
+    void* p;
+
+    pthread_mutex_lock(&arena_mutex);
+    for (k = 0; k < ARENA_MAX_BUFFERS; k++) {
+        if (!slots[k].p) {
+            if (livre < 0) livre = k;
+        } else if (!slots[k].in_use && slots[k].cap >= need &&
+                   (best < 0 || slots[k].cap < slots[best].cap)) {
+            best = k;
+        }
+    }
+    if (best >= 0) {
+        size_t dirty = slots[best].dirty < need ? slots[best].dirty : need;
+        slots[best].in_use = 1;
+        slots[best].rows = rows;
+        slots[best].row_bytes = row_bytes;
+        arena_reuses++;
+        pthread_mutex_unlock(&arena_mutex);
+        // Zerado só agora, com a divisão de linhas do novo uso; o que
+        // passa de 'need' continua sujo até um uso maior
+        zerar_linhas((char*)slots[best].p, dirty, row_bytes);
+        return slots[best].p;
+    }
+    // Reserva o slot antes de soltar o mutex para alocar
+    if (livre >= 0) {
+        slots[livre].in_use = 1;
+        slots[livre].p = SLOT_RESERVADO;
+    }
+    pthread_mutex_unlock(&arena_mutex);
+
+    cap = (need + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (posix_memalign(&p, ARENA_ALIGN, cap) != 0) {
+        p = NULL;
+    } else {
+#ifdef MADV_HUGEPAGE
+        madvise(p, cap, MADV_HUGEPAGE);
+#endif
+        zerar_linhas((char*)p, need, row_bytes);
+        memset((char*)p + need, 0, cap - need);
+    }
+
+    pthread_mutex_lock(&arena_mutex);
+    if (livre >= 0) {
+        if (p) {
+            slots[livre].p = p;
+            slots[livre].cap = cap;
+            slots[livre].rows = rows;
+            slots[livre].row_bytes = row_bytes;
+            arena_bytes += cap;
+        } else {
+            memset(&slots[livre], 0, sizeof(slots[livre]));
+        }
+    }
+    if (p) arena_allocs++;
+    pthread_mutex_unlock(&arena_mutex);
+    return p;
+}
+
+void board_release(void* board) {
+    size_t max_bytes = arena_max_bytes();
+    int k, slot = -1;
+
+    if (!board) return;
+    pthread_mutex_lock(&arena_mutex);
+    for (k = 0; k < ARENA_MAX_BUFFERS; k++)
+        if (slots[k].p == board) slot = k;
+    pthread_mutex_unlock(&arena_mutex);
+
+    if (slot < 0) {
+        free(board);   // alocado sem slot livre: não é guardado
+        return;
+    }
+
+    // Não é zerado aqui: quem o reaproveitar zera no board_alloc, e um
+    // buffer devolvido ao sistema pelo limite abaixo nem precisa
+    pthread_mutex_lock(&arena_mutex);
+    slots[slot].in_use = 0;
+    if (slots[slot].rows * slots[slot].row_bytes > slots[slot].dirty)
+        slots[slot].dirty = slots[slot].rows * slots[slot].row_bytes;
+    // Acima do limite, devolve ao sistema os maiores buffers livres
+    while (arena_bytes > max_bytes) {
+        int maior = -1;
+        for (k = 0; k < ARENA_MAX_BUFFERS; k++)
+            if (slots[k].p && !slots[k].in_use &&
+                (maior < 0 || slots[k].cap > slots[maior].cap))
+                maior = k;
+        if (maior < 0) break;
+        free(slots[maior].p);
+        arena_bytes -= slots[maior].cap;
+        memset(&slots[maior], 0, sizeof(slots[maior]));
+    }
+    pthread_mutex_unlock(&arena_mutex);
+}
+
+void board_arena_stats(arena_stats_t* stats) {
+    int k;
+    pthread_mutex_lock(&arena_mutex);
+    memset(stats, 0, sizeof(*stats));
+    for (k = 0; k < ARENA_MAX_BUFFERS; k++) {
+        if (!slots[k].p || slots[k].p == SLOT_RESERVADO) continue;
+        stats->buffers++;
+        if (slots[k].in_use) stats->in_use++;
+    }
+    stats->bytes = (double)arena_bytes;
+    stats->reuses = arena_reuses;
+    stats->allocs = arena_allocs;
+    pthread_mutex_unlock(&arena_mutex);
+}
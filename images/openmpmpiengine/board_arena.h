@@ -0,0 +1,32 @@
+#ifndef BOARD_ARENA_H
+#define BOARD_ARENA_H
+
+#include <stddef.h>
+
+// Arena de tabuleiros do processo: buffers alinhados a 2 MiB, com
+// transparent huge pages, reaproveitados entre requisições e tamanhos.
+// Todo buffer entregue por board_alloc está zerado. Buffers novos são
+// zerados em paralelo com a mesma distribuição de linhas (schedule static)
+// dos laços de cálculo, para que o first-touch coloque cada faixa de
+// linhas no nó NUMA da thread que vai processá-la. Um buffer devolvido
+// só é zerado quando board_alloc o reaproveita (a parte usada antes, da
+// mesma forma); os que a arena libera pelo limite não são zerados.
+
+#define ARENA_ALIGN (2UL << 20)
+#define ARENA_MAX_BUFFERS 32
+#define ARENA_DEFAULT_MAX_MB 1024   // sobrescrito por BOARD_ARENA_MAX_MB
+
+typedef struct {
+    int buffers;            // buffers guardados (livres + em uso)
+    int in_use;
+    double bytes;           // memória total guardada pela arena
+    unsigned long reuses;   // board_alloc atendidos por buffer reaproveitado
+    unsigned long allocs;   // buffers novos alocados
+} arena_stats_t;
+
+// Tabuleiro de 'rows' linhas de 'row_bytes' bytes; NULL se faltar memória
+void* board_alloc(size_t rows, size_t row_bytes);
+void board_release(void* board);
+void board_arena_stats(arena_stats_t* stats);
+
+#endif
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "checkpoint.h"
+#include "pattern.h"
+
+#define PAGE_ROUND(n) (((n) + 4095) & ~(size_t)4095)
+
+static double intervalo_padrao(void) {
+    const char* env = getenv("CHECKPOINT_INTERVAL");
+    double s = env ? atof(env) : 0.0;
+    return s > 0.0 ? s : CKPT_DEFAULT_INTERVAL;
+}
+
+// $CHECKPOINT_DIR/nome.ckpt; nomes com '/' ou '.' poderiam sair do diretório
+static int caminho(ckpt_t* c, const char* name) {
+    const char* dir = getenv("CHECKPOINT_DIR");
+    const char* s;
+
+    if (!name[0] || strlen(name) >= CKPT_NAME_LEN) {
+        snprintf(c->error, sizeof(c->error), "nome de checkpoint vazio ou com mais de %d caracteres", CKPT_NAME_LEN - 1);
+        return -1;
+    }
+    for (s = name; *s; s++)
+        if (!((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') ||
+              (*s >= '0' && *s <= '9') || *s == '-' || *s == '_')) {
+            snprintf(c->error, sizeof(c->error), "nome de checkpoint inválido (use letras, dígitos, - e _)");
+            return -1;
+        }
+    snprintf(c->path, sizeof(c->path), "%s/%s.ckpt", dir && dir[0] ? dir : CKPT_DEFAULT_DIR, name);
+    return 0;
+}
+
+// Trava exclusiva no arquivo enquanto estiver mapeado: outra execução com
+// o mesmo nome (neste processo ou em outro pod no mesmo volume) truncaria
+// ou escreveria por baixo do mapeamento
+static int travar(ckpt_t* c) {
+    if (flock(c->fd, LOCK_EX | LOCK_NB) == 0) return 0;
+    if (errno == EWOULDBLOCK)
+        snprintf(c->error, sizeof(c->error), "checkpoint %s em uso por outra execução", c->path);
+    else
+        snprintf(c->error, sizeof(c->error), "travando %s: %s", c->path, strerror(errno));
+    return -1;
+}
+
+static void tamanhos(ckpt_t* c, int tam) {
+    c->slot_bytes = PAGE_ROUND((size_t)(tam+2) * packed_words(tam) * sizeof(uint64_t));
+    c->bytes = CKPT_HEADER_BYTES + CKPT_SLOTS * c->slot_bytes;
+}
+
+static int mapear(ckpt_t* c) {
+    char* base = mmap(NULL, c->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0);
+    int k;
+
+    if (base == MAP_FAILED) {
+        snprintf(c->error, sizeof(c->error), "mmap de %s: %s", c->path, strerror(errno));
+        return -1;
+    }
+    c->hdr = (ckpt_header_t*)base;
+    for (k = 0; k < CKPT_SLOTS; k++)
+        c->slot[k] = (uint64_t*)(base + CKPT_HEADER_BYTES + k * c->slot_bytes);
+    c->interval = intervalo_padrao();
+    c->last_save = wall_time();
+    return 0;
+}
+
+int ckpt_create(ckpt_t* c, const char* name, int tam, long gens, const char* rule) {
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    if (caminho(c, name) < 0) return -1;
+    if (tam < 4 || tam > CKPT_MAX_TAM) {
+        snprintf(c->error, sizeof(c->error), "tam=%d fora de 4-%d", tam, CKPT_MAX_TAM);
+        return -1;
+    }
+    tamanhos(c, tam);
+
+    // Trunca só depois da trava; o arquivo esparso já nasce zerado, com
+    // bordas mortas em todos os slots
+    c->fd = open(c->path, O_RDWR | O_CREAT, 0644);
+    if (c->fd < 0) {
+        snprintf(c->error, sizeof(c->error), "criando %s: %s", c->path, strerror(errno));
+        return -1;
+    }
+    if (travar(c) < 0) {
+        ckpt_close(c);
+        return -1;
+    }
+    if (ftruncate(c->fd, 0) < 0 || ftruncate(c->fd, c->bytes) < 0) {
+        snprintf(c->error, sizeof(c->error), "criando %s: %s", c->path, strerror(errno));
+        ckpt_close(c);
+        return -1;
+    }
+    if (mapear(c) < 0) {
+        ckpt_close(c);
+        return -1;
+    }
+    memcpy(c->hdr->magic, CKPT_MAGIC, sizeof(c->hdr->magic));
+    c->hdr->tam = tam;
+    c->hdr->current = 0;
+    c->hdr->generation = 0;
+    c->hdr->gens = gens;
+    c->hdr->words = packed_words(tam);
+    snprintf(c->hdr->rule, sizeof(c->hdr->rule), "%s", rule);
+    return 0;
+}
+
+int ckpt_open(ckpt_t* c, const char* name) {
+    ckpt_header_t hdr;
+    struct stat st;
+
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    if (caminho(c, name) < 0) return -1;
+    c->fd = open(c->path, O_RDWR);
+    if (c->fd < 0) {
+        snprintf(c->error, sizeof(c->error), "abrindo %s: %s", c->path, strerror(errno));
+        return -1;
+    }
+    if (travar(c) < 0) {
+        ckpt_close(c);
+        return -1;
+    }
+    if (pread(c->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        memcmp(hdr.magic, CKPT_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.tam < 4 || hdr.tam > CKPT_MAX_TAM || hdr.words != packed_words(hdr.tam) ||
+        hdr.current < 0 || hdr.current >= CKPT_SLOTS || hdr.generation < 0) {
+        snprintf(c->error, sizeof(c->error), "%s não é um checkpoint válido", c->path);
+        ckpt_close(c);
+        return -1;
+    }
+    tamanhos(c, hdr.tam);
+    if (fstat(c->fd, &st) < 0 || (size_t)st.st_size < c->bytes) {
+        snprintf(c->error, sizeof(c->error), "%s truncado", c->path);
+        ckpt_close(c);
+        return -1;
+    }
+    if (mapear(c) < 0) {
+        ckpt_close(c);
+        return -1;
+    }
+    c->hdr->rule[sizeof(c->hdr->rule) - 1] = '\0';
+    return 0;
+}
+
+void ckpt_close(ckpt_t* c) {
+    if (c->hdr)
+        munmap(c->hdr, c->bytes);
+    if (c->fd >= 0)
+        close(c->fd);
+    c->hdr = NULL;
+    c->fd = -1;
+}
+
+void ckpt_set_interval(ckpt_t* c, double seconds) {
+    c->interval = seconds > 0.0 ? seconds : intervalo_padrao();
+}
+
+int ckpt_due(const ckpt_t* c) {
+    return wall_time() - c->last_save >= c->interval;
+}
+
+void ckpt_commit(ckpt_t* c, int slot, long generation) {
+    // O slot vai para o disco antes de o cabeçalho apontar para ele
+    msync(c->slot[slot], c->slot_bytes, MS_SYNC);
+    c->hdr->current = slot;
+    c->hdr->generation = generation;
+    c->hdr->saved_at = wall_time();
+    msync(c->hdr, CKPT_HEADER_BYTES, MS_SYNC);
+    c->last_save = wall_time();
+    c->saves++;
+}
+
+void ckpt_save_int(ckpt_t* c, const int* tabul, long generation) {
+    const int tam = c->hdr->tam, words = packed_words(tam);
+    int slot = (c->hdr->current + 1) % CKPT_SLOTS;
+    uint64_t* dst = c->slot[slot];
+    int i;
+
+    #pragma omp parallel for schedule(static)
+    for (i = 1; i <= tam; i++) {
+        const int* linha = tabul + ind2d(i,0);
+        uint64_t* out = dst + (size_t)i*words;
+        int j;
+        memset(out, 0, words*sizeof(uint64_t));
+        for (j = 1; j <= tam; j++)
+            out[j/64] |= (uint64_t)(linha[j] != 0) << (j%64);
+    }
+    ckpt_commit(c, slot, generation);
+}
+
+void ckpt_load_int(const ckpt_t* c, int* tabul) {
+    const int tam = c->hdr->tam;
+    const uint64_t* src = c->slot[c->hdr->current];
+    int i;
+
+    #pragma omp parallel for schedule(static)
+    for (i = 1; i <= tam; i++) {
+        int* linha = tabul + ind2d(i,0);
+        int j;
+        for (j = 1; j <= tam; j++)
+            linha[j] = packed_get(src, tam, i, j);
+    }
+}
+
+int ckpt_run_packed(ckpt_t* c, long gens, size_result_t* r, long* population, uint64_t* hash) {
+    const int tam = c->hdr->tam;
+    int cur = c->hdr->current, in = cur, out;
+    long g = c->hdr->generation;
+    double t0, t1, t2;
+
+    // O slot atual só é lido: as gerações alternam entre os outros dois,
+    // e o que recebeu a última geração vira o atual em cada gravação
+    t0 = wall_time();
+    while (g < gens) {
+        out = in == cur ? (cur + 1) % CKPT_SLOTS : 3 - cur - in;
+        UmaVidaPacked(c->slot[in], c->slot[out], tam);
+        in = out;
+        g++;
+        if (run_checkpoint(g)) break;
+        if (ckpt_due(c)) {
+            ckpt_commit(c, in, g);
+            cur = in;
+        }
+    }
+    if (in != cur)
+        ckpt_commit(c, in, g);
+    t1 = wall_time();
+
+    board_digest_packed(c->slot[in], tam, population, hash);
+    t2 = wall_time();
+
+    r->correct = -1;
+    r->init = 0.0; r->comp = t1 - t0; r->check = t2 - t1;
+    r->work = 0.0;
+    return 1;
+}
@@ -0,0 +1,78 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "game_of_life.h"
+#include "life_rules.h"
+
+// Checkpoints de tabuleiro num arquivo mapeado na memória (mmap). O arquivo
+// tem um cabeçalho de uma página (tam, geração, regra) seguido de três
+// slots com o tabuleiro compactado em bits, no formato de packed_words. A
+// gravação vai sempre para um slot que não é o atual, e só depois do msync
+// o cabeçalho passa a apontar para ele: um pod encerrado no meio de uma
+// gravação deixa o checkpoint anterior íntegro.
+//
+// O mesmo arquivo serve de memória no modo fora do núcleo (outofcore=1):
+// o kernel compactado alterna entre os dois slots livres direto sobre o
+// mapeamento, e a paginação do kernel decide o que fica em RAM, o que
+// permite tabuleiros maiores que a memória. Gravar um checkpoint aí é só
+// msync do slot com a última geração e trocar o slot atual.
+
+#define CKPT_MAGIC "GOLCKPT1"
+#define CKPT_HEADER_BYTES 4096
+#define CKPT_SLOTS 3
+#define CKPT_NAME_LEN 64
+#define CKPT_DEFAULT_DIR "/tmp"
+#define CKPT_DEFAULT_INTERVAL 30        // segundos; sobrescrito por CHECKPOINT_INTERVAL
+#define CKPT_MAX_TAM (1 << 20)          // fora do núcleo: 128 GiB por slot
+
+typedef struct {
+    char magic[8];
+    int32_t tam;
+    int32_t current;                // slot com a última geração gravada
+    int64_t generation;             // gerações concluídas nesse slot
+    int64_t gens;                   // total pedido pelo run que criou o arquivo
+    int64_t initial_population;
+    int64_t words;                  // palavras por linha (packed_words)
+    double saved_at;                // wall_time da última gravação
+    char rule[VIDA_REGRA_LEN];      // rulestring canônica
+} ckpt_header_t;
+
+typedef struct {
+    int fd;
+    char path[256];
+    ckpt_header_t* hdr;             // início do mapeamento
+    uint64_t* slot[CKPT_SLOTS];
+    size_t slot_bytes, bytes;
+    double interval, last_save;
+    int saves;                      // gravações feitas por este processo
+    char error[320];
+} ckpt_t;
+
+// Cria (ou trunca) $CHECKPOINT_DIR/nome.ckpt para um tabuleiro de lado
+// 'tam'. Nomes só com letras, dígitos, '-' e '_'. O arquivo fica travado
+// (flock) até ckpt_close: um nome em uso por outra execução é recusado.
+// Retorna 0, ou -1 com a mensagem em c->error.
+int ckpt_create(ckpt_t* c, const char* name, int tam, long gens, const char* rule);
+// Abre um checkpoint existente e valida o cabeçalho
+int ckpt_open(ckpt_t* c, const char* name);
+void ckpt_close(ckpt_t* c);
+
+// Intervalo entre gravações (<= 0 usa CHECKPOINT_INTERVAL)
+void ckpt_set_interval(ckpt_t* c, double seconds);
+// 1 se já passou o intervalo desde a última gravação
+int ckpt_due(const ckpt_t* c);
+
+// Compacta o tabuleiro de int num slot livre e o torna o atual
+void ckpt_save_int(ckpt_t* c, const int* tabul, long generation);
+// Descompacta o slot atual num tabuleiro de int zerado
+void ckpt_load_int(const ckpt_t* c, int* tabul);
+// Torna atual um slot que já contém a geração (modo fora do núcleo)
+void ckpt_commit(ckpt_t* c, int slot, long generation);
+
+// Avança o slot atual até a geração 'gens' com o kernel compactado (só
+// B3/S23), gravando a cada intervalo e ao parar; a população e o hash são
+// os de board_digest
+int ckpt_run_packed(ckpt_t* c, long gens, size_result_t* r, long* population, uint64_t* hash);
+
+#endif
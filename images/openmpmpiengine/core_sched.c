@@ -0,0 +1,112 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <omp.h>
+#include "core_sched.h"
+
+static int cpus[CORE_SCHED_MAX_CPUS];     // ids das CPUs gerenciadas
+static int livre[CORE_SCHED_MAX_CPUS];
+static int total = 0, nlivres = 0;
+static unsigned long proximo = 0, atendendo = 0;   // senhas da fila FIFO
+static unsigned long concessoes = 0;
+static pthread_mutex_t sched_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sched_cond = PTHREAD_COND_INITIALIZER;
+
+void core_sched_init(void) {
+    cpu_set_t set;
+    const char* env = getenv("ENGINE_CORES");
+    int limite = env ? atoi(env) : 0;
+    int c;
+
+    total = 0;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (c = 0; c < CPU_SETSIZE && total < CORE_SCHED_MAX_CPUS; c++) {
+            if (!CPU_ISSET(c, &set)) continue;
+            if (limite > 0 && total == limite) break;
+            cpus[total++] = c;
+        }
+    }
+    if (total == 0)
+        cpus[total++] = 0;
+    for (c = 0; c < total; c++)
+        livre[c] = 1;
+    nlivres = total;
+}
+
+int core_sched_total(void) {
+    return total;
+}
+
+void core_sched_acquire(int want, core_grant_t* grant) {
+    unsigned long senha;
+    int c;
+
+    if (want < 1) want = 1;
+    if (want > total) want = total;
+
+    pthread_mutex_lock(&sched_mutex);
+    senha = proximo++;
+    // Só o primeiro da fila pode pegar núcleos, para que jobs largos não
+    // sejam ultrapassados indefinidamente pelos estreitos
+    while (atendendo != senha || nlivres < want)
+        pthread_cond_wait(&sched_cond, &sched_mutex);
+
+    grant->ncpus = 0;
+    for (c = 0; c < total && grant->ncpus < want; c++) {
+        if (livre[c]) {
+            livre[c] = 0;
+            grant->cpus[grant->ncpus++] = c;
+        }
+    }
+    nlivres -= want;
+    atendendo++;
+    concessoes++;
+    pthread_cond_broadcast(&sched_cond);
+    pthread_mutex_unlock(&sched_mutex);
+}
+
+void core_sched_release(const core_grant_t* grant) {
+    int k;
+
+    pthread_mutex_lock(&sched_mutex);
+    for (k = 0; k < grant->ncpus; k++)
+        livre[grant->cpus[k]] = 1;
+    nlivres += grant->ncpus;
+    pthread_cond_broadcast(&sched_cond);
+    pthread_mutex_unlock(&sched_mutex);
+}
+
+void core_sched_pin_team(const core_grant_t* grant) {
+    omp_set_num_threads(grant->ncpus);
+
+    // O libgomp reaproveita as threads da equipe desta thread mestre nos
+    // laços seguintes, então a afinidade fixada aqui vale para o job todo
+    #pragma omp parallel num_threads(grant->ncpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[grant->cpus[omp_get_thread_num()]], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+}
+
+void core_sched_bind_thread(const core_grant_t* grant) {
+    cpu_set_t set;
+    int k;
+
+    CPU_ZERO(&set);
+    for (k = 0; k < grant->ncpus; k++)
+        CPU_SET(cpus[grant->cpus[k]], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void core_sched_stats(core_sched_stats_t* stats) {
+    pthread_mutex_lock(&sched_mutex);
+    stats->total = total;
+    stats->free = nlivres;
+    stats->waiting = (int)(proximo - atendendo);
+    stats->grants = concessoes;
+    pthread_mutex_unlock(&sched_mutex);
+}
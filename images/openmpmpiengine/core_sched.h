@@ -0,0 +1,42 @@
+#ifndef CORE_SCHED_H
+#define CORE_SCHED_H
+
+// Escalonador de núcleos do engine: reparte as CPUs do processo entre os
+// jobs em execução para que requisições concorrentes não disputem os
+// mesmos núcleos com equipes OpenMP completas. Os pedidos são atendidos em
+// ordem de chegada (FIFO), e cada job só começa quando todos os núcleos que
+// pediu estão livres; as threads da equipe ficam fixadas nesses núcleos.
+
+#define CORE_SCHED_MAX_CPUS 256
+
+typedef struct {
+    int ncpus;
+    int cpus[CORE_SCHED_MAX_CPUS];
+} core_grant_t;
+
+typedef struct {
+    int total;                  // núcleos gerenciados
+    int free;                   // núcleos livres agora
+    int waiting;                // jobs aguardando núcleos
+    unsigned long grants;       // concessões feitas desde o início
+} core_sched_stats_t;
+
+// Lê a máscara de afinidade do processo (limitada por ENGINE_CORES)
+void core_sched_init(void);
+int core_sched_total(void);
+
+// Bloqueia até conseguir 'want' núcleos (limitado ao total)
+void core_sched_acquire(int want, core_grant_t* grant);
+void core_sched_release(const core_grant_t* grant);
+
+// Ajusta a equipe OpenMP da thread chamadora ao tamanho da concessão e
+// fixa cada thread da equipe em um dos núcleos concedidos
+void core_sched_pin_team(const core_grant_t* grant);
+
+// Restringe só a thread chamadora (e os processos que ela criar) aos
+// núcleos concedidos, sem fixar thread a thread
+void core_sched_bind_thread(const core_grant_t* grant);
+
+void core_sched_stats(core_sched_stats_t* stats);
+
+#endif
@@ -0,0 +1,949 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <immintrin.h>
+#include <omp.h>
+#include "game_of_life.h"
+#include "board_arena.h"
+
+// Funções do Jogo da Vida
+__thread run_control_t* run_control = NULL;
+
+int run_checkpoint(long generation) {
+    if (!run_control) return 0;
+    atomic_store_explicit(&run_control->generation, generation, memory_order_relaxed);
+    return atomic_load_explicit(&run_control->cancel, memory_order_relaxed);
+}
+
+double wall_time(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return(tv.tv_sec + tv.tv_usec/1000000.0);
+}
+
+// Calcula as linhas ilo..ihi; o número de linhas do tabuleiro pode diferir
+// de tam (faixas do engine MPI), mas cada linha tem sempre tam+2 colunas.
+void UmaVidaFaixa(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) {
+    int i, j, vizviv;
+    
+    #pragma omp parallel for private(i, j, vizviv)
+    for (i=ilo; i<=ihi; i++) {
+        for (j=1; j<=tam; j++) {
+            vizviv = tabulIn[ind2d(i-1,j-1)] + tabulIn[ind2d(i-1,j)] +
+                    tabulIn[ind2d(i-1,j+1)] + tabulIn[ind2d(i,j-1)] +
+                    tabulIn[ind2d(i,j+1)] + tabulIn[ind2d(i+1,j-1)] +
+                    tabulIn[ind2d(i+1,j)] + tabulIn[ind2d(i+1,j+1)];
+            
+            if (tabulIn[ind2d(i,j)] && vizviv < 2)
+                tabulOut[ind2d(i,j)] = 0;
+            else if (tabulIn[ind2d(i,j)] && vizviv > 3)
+                tabulOut[ind2d(i,j)] = 0;
+            else if (!tabulIn[ind2d(i,j)] && vizviv == 3)
+                tabulOut[ind2d(i,j)] = 1;
+            else
+                tabulOut[ind2d(i,j)] = tabulIn[ind2d(i,j)];
+        }
+    }
+}
+
+void UmaVida(int* tabulIn, int* tabulOut, int tam) {
+    UmaVidaFaixa(tabulIn, tabulOut, tam, 1, tam);
+}
+
+// Kernels vetorizados: n = soma dos 8 vizinhos, c = célula central.
+// A regra B3/S23 equivale a (n | c) == 3, sem desvios no laço interno.
+static inline int vida_escalar(const int* tabulIn, int tam, int i, int j) {
+    int n = tabulIn[ind2d(i-1,j-1)] + tabulIn[ind2d(i-1,j)] + tabulIn[ind2d(i-1,j+1)] +
+            tabulIn[ind2d(i,j-1)] + tabulIn[ind2d(i,j+1)] +
+            tabulIn[ind2d(i+1,j-1)] + tabulIn[ind2d(i+1,j)] + tabulIn[ind2d(i+1,j+1)];
+    return (n | tabulIn[ind2d(i,j)]) == 3;
+}
+
+__attribute__((target("sse4.2")))
+void UmaVidaSSE4(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) {
+    int i;
+
+    #pragma omp parallel for private(i)
+    for (i=ilo; i<=ihi; i++) {
+        const int *up = tabulIn + ind2d(i-1,0), *mid = tabulIn + ind2d(i,0);
+        const int *down = tabulIn + ind2d(i+1,0);
+        int* out = tabulOut + ind2d(i,0);
+        const __m128i tres = _mm_set1_epi32(3), um = _mm_set1_epi32(1);
+        int j;
+
+        for (j=1; j+3<=tam; j+=4) {
+            __m128i n = _mm_add_epi32(
+                _mm_add_epi32(
+                    _mm_add_epi32(_mm_loadu_si128((const __m128i*)(up+j-1)),
+                                  _mm_loadu_si128((const __m128i*)(up+j))),
+                    _mm_add_epi32(_mm_loadu_si128((const __m128i*)(up+j+1)),
+                                  _mm_loadu_si128((const __m128i*)(mid+j-1)))),
+                _mm_add_epi32(
+                    _mm_add_epi32(_mm_loadu_si128((const __m128i*)(mid+j+1)),
+                                  _mm_loadu_si128((const __m128i*)(down+j-1))),
+                    _mm_add_epi32(_mm_loadu_si128((const __m128i*)(down+j)),
+                                  _mm_loadu_si128((const __m128i*)(down+j+1)))));
+            __m128i c = _mm_loadu_si128((const __m128i*)(mid+j));
+            __m128i v = _mm_cmpeq_epi32(_mm_or_si128(n, c), tres);
+            _mm_storeu_si128((__m128i*)(out+j), _mm_and_si128(v, um));
+        }
+        for (; j<=tam; j++)
+            out[j] = vida_escalar(tabulIn, tam, i, j);
+    }
+}
+
+__attribute__((target("avx2")))
+void UmaVidaAVX2(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) {
+    int i;
+
+    #pragma omp parallel for private(i)
+    for (i=ilo; i<=ihi; i++) {
+        const int *up = tabulIn + ind2d(i-1,0), *mid = tabulIn + ind2d(i,0);
+        const int *down = tabulIn + ind2d(i+1,0);
+        int* out = tabulOut + ind2d(i,0);
+        const __m256i tres = _mm256_set1_epi32(3), um = _mm256_set1_epi32(1);
+        int j;
+
+        for (j=1; j+7<=tam; j+=8) {
+            __m256i n = _mm256_add_epi32(
+                _mm256_add_epi32(
+                    _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(up+j-1)),
+                                     _mm256_loadu_si256((const __m256i*)(up+j))),
+                    _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(up+j+1)),
+                                     _mm256_loadu_si256((const __m256i*)(mid+j-1)))),
+                _mm256_add_epi32(
+                    _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(mid+j+1)),
+                                     _mm256_loadu_si256((const __m256i*)(down+j-1))),
+                    _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(down+j)),
+                                     _mm256_loadu_si256((const __m256i*)(down+j+1)))));
+            __m256i c = _mm256_loadu_si256((const __m256i*)(mid+j));
+            __m256i v = _mm256_cmpeq_epi32(_mm256_or_si256(n, c), tres);
+            _mm256_storeu_si256((__m256i*)(out+j), _mm256_and_si256(v, um));
+        }
+        for (; j<=tam; j++)
+            out[j] = vida_escalar(tabulIn, tam, i, j);
+    }
+}
+
+__attribute__((target("avx512f")))
+void UmaVidaAVX512(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) {
+    int i;
+
+    #pragma omp parallel for private(i)
+    for (i=ilo; i<=ihi; i++) {
+        const int *up = tabulIn + ind2d(i-1,0), *mid = tabulIn + ind2d(i,0);
+        const int *down = tabulIn + ind2d(i+1,0);
+        int* out = tabulOut + ind2d(i,0);
+        const __m512i tres = _mm512_set1_epi32(3), um = _mm512_set1_epi32(1);
+        int j;
+
+        for (j=1; j+15<=tam; j+=16) {
+            __m512i n = _mm512_add_epi32(
+                _mm512_add_epi32(
+                    _mm512_add_epi32(_mm512_loadu_si512(up+j-1), _mm512_loadu_si512(up+j)),
+                    _mm512_add_epi32(_mm512_loadu_si512(up+j+1), _mm512_loadu_si512(mid+j-1))),
+                _mm512_add_epi32(
+                    _mm512_add_epi32(_mm512_loadu_si512(mid+j+1), _mm512_loadu_si512(down+j-1)),
+                    _mm512_add_epi32(_mm512_loadu_si512(down+j), _mm512_loadu_si512(down+j+1))));
+            __m512i c = _mm512_loadu_si512(mid+j);
+            __mmask16 v = _mm512_cmpeq_epi32_mask(_mm512_or_si512(n, c), tres);
+            _mm512_storeu_si512(out+j, _mm512_maskz_mov_epi32(v, um));
+        }
+        for (; j<=tam; j++)
+            out[j] = vida_escalar(tabulIn, tam, i, j);
+    }
+}
+
+const vida_kernel_t vida_kernels[] = {
+    { "scalar", NULL,      UmaVidaFaixa },
+    { "sse4",   "sse4.2",  UmaVidaSSE4 },
+    { "avx2",   "avx2",    UmaVidaAVX2 },
+    { "avx512", "avx512f", UmaVidaAVX512 },
+};
+const int num_vida_kernels = sizeof(vida_kernels)/sizeof(vida_kernels[0]);
+
+const vida_kernel_t* vida_kernel = &vida_kernels[0];
+
+int kernel_supported(const vida_kernel_t* k) {
+    if (!k->cpu_feature) return 1;
+    if (strcmp(k->cpu_feature, "sse4.2") == 0) return __builtin_cpu_supports("sse4.2");
+    if (strcmp(k->cpu_feature, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(k->cpu_feature, "avx512f") == 0) return __builtin_cpu_supports("avx512f");
+    return 0;
+}
+
+// Escolher o kernel mais largo suportado pela CPU (CPUID). A variável
+// GOL_KERNEL força um kernel específico, se a CPU o suportar.
+void select_vida_kernel(void) {
+    const char* forced = getenv("GOL_KERNEL");
+    int k;
+
+    __builtin_cpu_init();
+    for (k = 0; k < num_vida_kernels; k++) {
+        if (!kernel_supported(&vida_kernels[k])) continue;
+        if (forced && strcmp(forced, vida_kernels[k].name) == 0) {
+            vida_kernel = &vida_kernels[k];
+            return;
+        }
+        if (!forced) vida_kernel = &vida_kernels[k];
+    }
+    if (forced)
+        printf("AVISO: kernel %s indisponível, usando %s\n", forced, vida_kernel->name);
+}
+
+// Coloca o glider inicial num tabuleiro já zerado
+void InitGlider(int* tabulIn, int tam) {
+    tabulIn[ind2d(1,2)] = 1; tabulIn[ind2d(2,3)] = 1;
+    tabulIn[ind2d(3,1)] = 1; tabulIn[ind2d(3,2)] = 1;
+    tabulIn[ind2d(3,3)] = 1;
+}
+
+// Zera por linhas com a mesma divisão estática do laço de cálculo, para
+// que o first-touch deixe cada faixa no nó NUMA da thread que a processa
+void InitTabul(int* tabulIn, int* tabulOut, int tam) {
+    int i;
+    #pragma omp parallel for schedule(static)
+    for (i=0; i<tam+2; i++) {
+        memset(tabulIn + ind2d(i,0), 0, (tam+2)*sizeof(int));
+        memset(tabulOut + ind2d(i,0), 0, (tam+2)*sizeof(int));
+    }
+    InitGlider(tabulIn, tam);
+}
+
+int Correto(int* tabul, int tam) {
+    int ij, cnt = 0;
+    for (ij=0; ij<(tam+2)*(tam+2); ij++)
+        cnt += tabul[ij];
+    return (cnt == 5 && tabul[ind2d(tam-2,tam-1)] &&
+            tabul[ind2d(tam-1,tam)] && tabul[ind2d(tam,tam-2)] &&
+            tabul[ind2d(tam,tam-1)] && tabul[ind2d(tam,tam)]);
+}
+
+// Somador completo bit a bit: 64 somas independentes de 3 bits
+#define FULL_ADD(s, c, a, b, d) do { \
+    uint64_t _t = (a) ^ (b);        \
+    (s) = _t ^ (d);                 \
+    (c) = ((a) & (b)) | (_t & (d)); \
+} while (0)
+
+void UmaVidaPacked(const uint64_t* tabulIn, uint64_t* tabulOut, int tam) {
+    int i;
+    const int words = packed_words(tam);
+    // A coluna tam está na palavra tam/64, bit tam%64; a borda tam+1 fica
+    // logo depois, na mesma palavra ou (tam%64 == 63) sozinha na seguinte
+    const int last_word = tam / 64, last_bit = tam % 64;
+    const uint64_t last_mask = last_bit == 63 ? ~0ULL : (1ULL << (last_bit + 1)) - 1;
+
+    #pragma omp parallel for private(i)
+    for (i=1; i<=tam; i++) {
+        const uint64_t* up = tabulIn + (size_t)(i-1)*words;
+        const uint64_t* mid = tabulIn + (size_t)i*words;
+        const uint64_t* down = tabulIn + (size_t)(i+1)*words;
+        uint64_t* out = tabulOut + (size_t)i*words;
+        int w;
+
+        for (w=0; w<words; w++) {
+            uint64_t u = up[w], m = mid[w], d = down[w];
+            uint64_t ul = w > 0 ? up[w-1] >> 63 : 0, ur = w < words-1 ? up[w+1] << 63 : 0;
+            uint64_t ml = w > 0 ? mid[w-1] >> 63 : 0, mr = w < words-1 ? mid[w+1] << 63 : 0;
+            uint64_t dl = w > 0 ? down[w-1] >> 63 : 0, dr = w < words-1 ? down[w+1] << 63 : 0;
+
+            // Oito vizinhos alinhados com a célula central de cada bit
+            uint64_t nw = (u << 1) | ul, n = u, ne = (u >> 1) | ur;
+            uint64_t we = (m << 1) | ml, ea = (m >> 1) | mr;
+            uint64_t sw = (d << 1) | dl, s = d, se = (d >> 1) | dr;
+
+            // Contagem de vizinhos vivos em 3 bits (mod 8) por somadores em árvore
+            uint64_t s_a, c_a, s_b, c_b, s_c, c_c, b0, c1, t0, t1, b1, t2, b2;
+            FULL_ADD(s_a, c_a, nw, n, ne);
+            FULL_ADD(s_b, c_b, we, ea, sw);
+            s_c = s ^ se; c_c = s & se;
+            FULL_ADD(b0, c1, s_a, s_b, s_c);
+            FULL_ADD(t0, t1, c_a, c_b, c_c);
+            b1 = t0 ^ c1; t2 = t0 & c1;
+            b2 = t1 ^ t2;
+
+            // Vive com 3 vizinhos, ou com 2 se já estava viva (B3/S23)
+            out[w] = ~b2 & b1 & (b0 | m);
+        }
+        out[0] &= ~1ULL;
+        out[last_word] &= last_mask;
+        for (w=last_word+1; w<words; w++)
+            out[w] = 0;
+    }
+}
+
+void InitGliderPacked(uint64_t* tabulIn, int tam) {
+    packed_set(tabulIn, tam, 1, 2); packed_set(tabulIn, tam, 2, 3);
+    packed_set(tabulIn, tam, 3, 1); packed_set(tabulIn, tam, 3, 2);
+    packed_set(tabulIn, tam, 3, 3);
+}
+
+void InitTabulPacked(uint64_t* tabulIn, uint64_t* tabulOut, int tam) {
+    const int words = packed_words(tam);
+    int i;
+    #pragma omp parallel for schedule(static)
+    for (i=0; i<tam+2; i++) {
+        memset(tabulIn + (size_t)i*words, 0, words*sizeof(uint64_t));
+        memset(tabulOut + (size_t)i*words, 0, words*sizeof(uint64_t));
+    }
+    InitGliderPacked(tabulIn, tam);
+}
+
+int CorretoPacked(const uint64_t* tabul, int tam) {
+    size_t w, n = (size_t)(tam+2)*packed_words(tam);
+    long cnt = 0;
+    for (w=0; w<n; w++)
+        cnt += __builtin_popcountll(tabul[w]);
+    return (cnt == 5 && packed_get(tabul, tam, tam-2, tam-1) &&
+            packed_get(tabul, tam, tam-1, tam) && packed_get(tabul, tam, tam, tam-2) &&
+            packed_get(tabul, tam, tam, tam-1) && packed_get(tabul, tam, tam, tam));
+}
+
+// Blocagem temporal com zonas fantasma sobrepostas: cada bloco tile x tile
+// é copiado com uma borda de tblock células para um buffer local, avança
+// tblock gerações dentro da cache (a região válida encolhe uma célula por
+// geração) e só o centro é escrito de volta no tabuleiro global.
+__attribute__((target_clones("avx512f", "avx2", "default")))
+static void vida_local(const int* in, int* out, int lado, int s,
+                       int ilo, int ihi, int jlo, int jhi) {
+    int li, lj;
+    // Só as células em [s, lado-s) continuam válidas após o passo s, e só
+    // as que pertencem ao interior global [ilo,ihi) x [jlo,jhi) são vivas.
+    if (ilo < s) ilo = s;
+    if (ihi > lado-s) ihi = lado-s;
+    if (jlo < s) jlo = s;
+    if (jhi > lado-s) jhi = lado-s;
+    for (li = ilo; li < ihi; li++) {
+        const int *up = in + (size_t)(li-1)*lado, *mid = in + (size_t)li*lado, *down = in + (size_t)(li+1)*lado;
+        int* o = out + (size_t)li*lado;
+        #pragma omp simd
+        for (lj = jlo; lj < jhi; lj++) {
+            int n = up[lj-1] + up[lj] + up[lj+1] + mid[lj-1] + mid[lj+1] +
+                    down[lj-1] + down[lj] + down[lj+1];
+            o[lj] = (n | mid[lj]) == 3;
+        }
+    }
+}
+
+// Avança 'gens' gerações de tabulIn para tabulOut (gens <= tblock)
+int UmaVidaTiled(int* tabulIn, int* tabulOut, int tam, int tile, int gens) {
+    if (tile > tam) tile = tam;
+    const int lado = tile + 2*gens;
+    const int ntiles = (tam + tile - 1) / tile;
+    const size_t area = (size_t)lado*lado;
+    int t, falhou = 0;
+
+    #pragma omp parallel
+    {
+        int* bufA = (int*)malloc(2*area*sizeof(int));
+        int* bufB = bufA + area;
+
+        // Sem o buffer de uma thread a geração fica incompleta: nenhuma calcula
+        if (!bufA) {
+            #pragma omp atomic write
+            falhou = 1;
+        }
+        #pragma omp barrier
+
+        if (!falhou) {
+            #pragma omp for schedule(static) private(t)
+            for (t = 0; t < ntiles*ntiles; t++) {
+                // Canto global (gi0,gj0) da célula local (0,0)
+                int ti = 1 + (t / ntiles)*tile, tj = 1 + (t % ntiles)*tile;
+                int gi0 = ti - gens, gj0 = tj - gens;
+                int th = tam+1 - ti < tile ? tam+1 - ti : tile;
+                int tw = tam+1 - tj < tile ? tam+1 - tj : tile;
+                // Interior global [1, tam] em coordenadas locais
+                int ilo = 1 - gi0, ihi = tam+1 - gi0, jlo = 1 - gj0, jhi = tam+1 - gj0;
+                int li, s;
+                int *a = bufA, *b = bufB, *tmp;
+
+                // Só blocos que encostam na borda global têm células mortas fixas
+                if (ilo > 0 || jlo > 0 || ihi < lado || jhi < lado)
+                    memset(bufA, 0, 2*area*sizeof(int));
+                for (li = (ilo > 0 ? ilo : 0); li < (ihi < lado ? ihi : lado); li++) {
+                    int c0 = jlo > 0 ? jlo : 0, c1 = jhi < lado ? jhi : lado;
+                    memcpy(a + (size_t)li*lado + c0, tabulIn + ind2d(gi0+li, gj0+c0), (c1-c0)*sizeof(int));
+                }
+
+                for (s = 1; s <= gens; s++) {
+                    vida_local(a, b, lado, s, ilo, ihi, jlo, jhi);
+                    tmp = a; a = b; b = tmp;
+                }
+
+                for (li = gens; li < gens+th; li++)
+                    memcpy(tabulOut + ind2d(gi0+li, tj), a + (size_t)li*lado + gens, tw*sizeof(int));
+            }
+        }
+        free(bufA);
+    }
+    return !falhou;
+}
+
+// Rastreamento de regiões ativas: o tabuleiro é dividido em blocos de
+// ACTIVE_TILE x ACTIVE_TILE e só são recalculados os blocos que mudaram na
+// geração anterior ou que vizinham um bloco que mudou. Um bloco inativo já
+// tem o valor correto no buffer de saída: ele guarda a geração g-1, que é
+// igual à geração g nesse bloco.
+__attribute__((target_clones("avx512f", "avx2", "default")))
+static int vida_bloco(const int* tabulIn, int* tabulOut, int tam,
+                      int i0, int i1, int j0, int j1) {
+    int i, j, mudou = 0;
+    for (i = i0; i <= i1; i++) {
+        const int *up = tabulIn + ind2d(i-1,0), *mid = tabulIn + ind2d(i,0);
+        const int *down = tabulIn + ind2d(i+1,0);
+        int* o = tabulOut + ind2d(i,0);
+        #pragma omp simd reduction(|:mudou)
+        for (j = j0; j <= j1; j++) {
+            int n = up[j-1] + up[j] + up[j+1] + mid[j-1] + mid[j+1] +
+                    down[j-1] + down[j] + down[j+1];
+            int v = (n | mid[j]) == 3;
+            mudou |= v ^ mid[j];
+            o[j] = v;
+        }
+    }
+    return mudou;
+}
+
+// Monta a lista de blocos ativos (os que mudaram e seus 8 vizinhos) a
+// partir da lista de blocos que mudaram, em tempo proporcional à atividade.
+// 'marca' deve vir zerado e é zerado de novo antes de retornar.
+static int marcar_ativos(const int* mudaram, int nmud, int nt,
+                         unsigned char* marca, int* lista) {
+    int k, di, dj, n = 0;
+    for (k = 0; k < nmud; k++) {
+        int ti = mudaram[k] / nt, tj = mudaram[k] % nt;
+        for (di = -1; di <= 1; di++)
+            for (dj = -1; dj <= 1; dj++) {
+                int vi = ti + di, vj = tj + dj;
+                if (vi >= 0 && vi < nt && vj >= 0 && vj < nt && !marca[vi*nt + vj]) {
+                    marca[vi*nt + vj] = 1;
+                    lista[n++] = vi*nt + vj;
+                }
+            }
+    }
+    for (k = 0; k < n; k++)
+        marca[lista[k]] = 0;
+    return n;
+}
+
+// Executar um tamanho com tabuleiro de int; retorna 0 se faltar memória
+int run_size_int(int tam, size_result_t* r) {
+    int i, *tabulIn, *tabulOut;
+    double t0, t1, t2, t3;
+
+    t0 = wall_time();
+    tabulIn = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    tabulOut = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    if (!tabulIn || !tabulOut) {
+        board_release(tabulIn);
+        board_release(tabulOut);
+        return 0;
+    }
+
+    InitGlider(tabulIn, tam);
+    t1 = wall_time();
+
+    for (i = 0; i < 2*(tam-3); i++) {
+        vida_kernel->fn(tabulIn, tabulOut, tam, 1, tam);
+        vida_kernel->fn(tabulOut, tabulIn, tam, 1, tam);
+        if (run_checkpoint(2L*(i+1))) break;
+    }
+    t2 = wall_time();
+
+    r->correct = Correto(tabulIn, tam);
+    t3 = wall_time();
+
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    board_release(tabulIn);
+    board_release(tabulOut);
+    return 1;
+}
+
+// Executar um tamanho com tabuleiro compactado em bits
+int run_size_packed(int tam, size_result_t* r) {
+    int i;
+    uint64_t *tabulIn, *tabulOut;
+    double t0, t1, t2, t3;
+
+    t0 = wall_time();
+    tabulIn = (uint64_t*)board_alloc(tam+2, packed_words(tam)*sizeof(uint64_t));
+    tabulOut = (uint64_t*)board_alloc(tam+2, packed_words(tam)*sizeof(uint64_t));
+    if (!tabulIn || !tabulOut) {
+        board_release(tabulIn);
+        board_release(tabulOut);
+        return 0;
+    }
+
+    InitGliderPacked(tabulIn, tam);
+    t1 = wall_time();
+
+    for (i = 0; i < 2*(tam-3); i++) {
+        UmaVidaPacked(tabulIn, tabulOut, tam);
+        UmaVidaPacked(tabulOut, tabulIn, tam);
+        if (run_checkpoint(2L*(i+1))) break;
+    }
+    t2 = wall_time();
+
+    r->correct = CorretoPacked(tabulIn, tam);
+    t3 = wall_time();
+
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    board_release(tabulIn);
+    board_release(tabulOut);
+    return 1;
+}
+
+// Executar um tamanho em blocos temporais de 'tblock' gerações
+int run_size_tiled(int tam, int tile, int tblock, size_result_t* r) {
+    int *tabulIn, *tabulOut, *tmp;
+    int gens, total = 4*(tam-3);
+    double t0, t1, t2, t3;
+
+    t0 = wall_time();
+    tabulIn = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    tabulOut = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    if (!tabulIn || !tabulOut) {
+        board_release(tabulIn);
+        board_release(tabulOut);
+        return 0;
+    }
+
+    InitGlider(tabulIn, tam);
+    t1 = wall_time();
+
+    // Mesmo número de gerações do laço original: 2*(tam-3) pares
+    if (tile > tam) tile = tam;
+    if (tblock > tile) tblock = tile;
+    for (; total > 0; total -= gens) {
+        gens = total < tblock ? total : tblock;
+        if (!UmaVidaTiled(tabulIn, tabulOut, tam, tile, gens)) {
+            board_release(tabulIn);
+            board_release(tabulOut);
+            return 0;
+        }
+        tmp = tabulIn; tabulIn = tabulOut; tabulOut = tmp;
+        if (run_checkpoint(4L*(tam-3) - total + gens)) break;
+    }
+    t2 = wall_time();
+
+    r->correct = Correto(tabulIn, tam);
+    t3 = wall_time();
+
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    board_release(tabulIn);
+    board_release(tabulOut);
+    return 1;
+}
+
+// Executar um tamanho recalculando só os blocos ativos. Quando mais de
+// ACTIVE_DENSE_FRACTION dos blocos está ativa, o tabuleiro é considerado
+// denso e as próximas ACTIVE_DENSE_GENS gerações usam varreduras completas
+// com o kernel vetorizado, seguidas de uma geração que recalcula tudo para
+// reconstruir a lista de blocos que mudaram.
+int run_size_active(int tam, size_result_t* r) {
+    int *tabulIn, *tabulOut, *tmp;
+    int g, k, densas = 0, total = 4*(tam-3);
+    int nt = (tam + ACTIVE_TILE - 1) / ACTIVE_TILE, ntiles = nt*nt;
+    int nativos, nmud;
+    unsigned char *marca, *flag;
+    int *lista, *mudaram;
+    double t0, t1, t2, t3, calculadas = 0.0;
+
+    t0 = wall_time();
+    tabulIn = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    tabulOut = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    marca = (unsigned char*)calloc(ntiles, 1);
+    flag = (unsigned char*)malloc(ntiles);
+    lista = (int*)malloc(ntiles*sizeof(int));
+    mudaram = (int*)malloc(ntiles*sizeof(int));
+    if (!tabulIn || !tabulOut || !marca || !flag || !lista || !mudaram) {
+        board_release(tabulIn);
+        board_release(tabulOut);
+        free(marca);
+        free(flag);
+        free(lista);
+        free(mudaram);
+        return 0;
+    }
+
+    InitGlider(tabulIn, tam);
+    t1 = wall_time();
+
+    // A primeira geração calcula todos os blocos para preencher o buffer
+    // de saída; o mesmo vale para a primeira geração após um trecho denso
+    nativos = ntiles;
+    for (k = 0; k < ntiles; k++) lista[k] = k;
+
+    for (g = 0; g < total; g++) {
+        if (densas > 0) {
+            vida_kernel->fn(tabulIn, tabulOut, tam, 1, tam);
+            calculadas += (double)tam*tam;
+            if (--densas == 0) {
+                nativos = ntiles;
+                for (k = 0; k < ntiles; k++) lista[k] = k;
+            }
+        } else {
+            #pragma omp parallel for schedule(dynamic, 4)
+            for (k = 0; k < nativos; k++) {
+                int t = lista[k];
+                int i0 = 1 + (t / nt)*ACTIVE_TILE, j0 = 1 + (t % nt)*ACTIVE_TILE;
+                int i1 = i0 + ACTIVE_TILE - 1 < tam ? i0 + ACTIVE_TILE - 1 : tam;
+                int j1 = j0 + ACTIVE_TILE - 1 < tam ? j0 + ACTIVE_TILE - 1 : tam;
+                flag[k] = vida_bloco(tabulIn, tabulOut, tam, i0, i1, j0, j1);
+            }
+            calculadas += (double)nativos*ACTIVE_TILE*ACTIVE_TILE;
+
+            for (k = 0, nmud = 0; k < nativos; k++)
+                if (flag[k]) mudaram[nmud++] = lista[k];
+            nativos = marcar_ativos(mudaram, nmud, nt, marca, lista);
+            if (nativos > ntiles * ACTIVE_DENSE_FRACTION)
+                densas = ACTIVE_DENSE_GENS;
+        }
+        tmp = tabulIn; tabulIn = tabulOut; tabulOut = tmp;
+        if (run_checkpoint(g + 1)) break;
+    }
+    t2 = wall_time();
+
+    r->correct = Correto(tabulIn, tam);
+    t3 = wall_time();
+
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    r->work = calculadas / ((double)total*tam*tam);
+    if (r->work > 1.0) r->work = 1.0;
+    board_release(tabulIn);
+    board_release(tabulOut);
+    free(marca);
+    free(flag);
+    free(lista);
+    free(mudaram);
+    return 1;
+}
+
+// Detecção de ciclos. O hash de uma geração é H = soma de a^i * b^j sobre
+// as células vivas (i,j), mod 2^64; transladar o padrão por (di,dj)
+// multiplica H por a^di * b^dj, então H * a^-top * b^-left (a e b ímpares
+// têm inverso mod 2^64) identifica o padrão independente da posição.
+#define CYCLE_HASH_A 0x9E3779B97F4A7C15ULL
+#define CYCLE_HASH_B 0xC2B2AE3D27D4EB4FULL
+
+typedef struct {
+    uint64_t hash;                  // relativo ao canto superior esquerdo da caixa
+    long pop;
+    int top, left, bottom, right;   // caixa envolvente; vazia se pop == 0
+} resumo_t;
+
+typedef struct {
+    uint64_t *pa, *pb;      // a^i, b^j
+    uint64_t *ia, *ib;      // a^-i, b^-j
+} potencias_t;
+
+const char* cycle_kind_name(cycle_kind_t kind) {
+    switch (kind) {
+        case CYCLE_STILL: return "estatico";
+        case CYCLE_OSCILLATOR: return "oscilador";
+        case CYCLE_SPACESHIP: return "nave";
+        default: return "nenhum";
+    }
+}
+
+// Inverso mod 2^64 por Newton: x = a já acerta os 3 bits menos
+// significativos e cada passo dobra os bits corretos
+static uint64_t inverso64(uint64_t a) {
+    uint64_t x = a;
+    int k;
+    for (k = 0; k < 5; k++) x *= 2 - a*x;
+    return x;
+}
+
+static void fechar_resumo(resumo_t* s, uint64_t hash, long pop, int top, int left,
+                          int bottom, int right, const potencias_t* pw, int tam) {
+    s->pop = pop;
+    if (pop == 0) {
+        s->hash = 0;
+        s->top = s->left = tam + 1;
+        s->bottom = s->right = 0;
+        return;
+    }
+    s->hash = hash * pw->ia[top] * pw->ib[left];
+    s->top = top; s->left = left; s->bottom = bottom; s->right = right;
+}
+
+// Resumo de um tabuleiro inteiro, só para a geração inicial
+static void resumir(const int* tabul, int tam, const potencias_t* pw, resumo_t* s) {
+    uint64_t hash = 0;
+    long pop = 0;
+    int i, j, top = tam + 1, left = tam + 1, bottom = 0, right = 0;
+    for (i = 1; i <= tam; i++)
+        for (j = 1; j <= tam; j++)
+            if (tabul[ind2d(i,j)]) {
+                hash += pw->pa[i] * pw->pb[j];
+                pop++;
+                if (i < top) top = i;
+                if (i > bottom) bottom = i;
+                if (j < left) left = j;
+                if (j > right) right = j;
+            }
+    fechar_resumo(s, hash, pop, top, left, bottom, right, pw, tam);
+}
+
+// Uma linha da geração seguinte nas colunas j0..j1, acumulando na mesma
+// passada a população, o hash (sem o fator a^i) e as colunas extremas
+__attribute__((target_clones("avx512f", "avx2", "default")))
+static long vida_linha_resumo(const int* tabulIn, int* tabulOut, int tam, int i,
+                              int j0, int j1, const uint64_t* pb,
+                              uint64_t* hash, int* left, int* right) {
+    const int *up = tabulIn + ind2d(i-1,0), *mid = tabulIn + ind2d(i,0);
+    const int *down = tabulIn + ind2d(i+1,0);
+    int* o = tabulOut + ind2d(i,0);
+    long pop = 0;
+    uint64_t h = 0;
+    int j, lo = tam + 1, hi = 0;
+    #pragma omp simd reduction(+:pop,h) reduction(min:lo) reduction(max:hi)
+    for (j = j0; j <= j1; j++) {
+        int n = up[j-1] + up[j] + up[j+1] + mid[j-1] + mid[j+1] +
+                down[j-1] + down[j] + down[j+1];
+        int v = (n | mid[j]) == 3;
+        o[j] = v;
+        pop += v;
+        h += (uint64_t)v * pb[j];
+        lo = v && j < lo ? j : lo;
+        hi = v && j > hi ? j : hi;
+    }
+    *hash = h; *left = lo; *right = hi;
+    return pop;
+}
+
+// Uma geração restrita à caixa da geração atual (s_in) aumentada de uma
+// célula, onde podem nascer células, unida à caixa da geração anterior
+// (s_out), cujas células ainda estão em tabulOut e precisam ser apagadas.
+// Fora dessa região os dois buffers já estão zerados.
+static void vida_resumo(const int* tabulIn, int* tabulOut, int tam, const resumo_t* s_in,
+                        const resumo_t* s_out, const potencias_t* pw, resumo_t* s) {
+    uint64_t hash = 0;
+    long pop = 0;
+    int i, top = tam + 1, left = tam + 1, bottom = 0, right = 0;
+    int ilo = tam + 1, ihi = 0, jlo = tam + 1, jhi = 0;
+
+    if (s_in->pop) {
+        ilo = s_in->top > 1 ? s_in->top - 1 : 1;
+        ihi = s_in->bottom < tam ? s_in->bottom + 1 : tam;
+        jlo = s_in->left > 1 ? s_in->left - 1 : 1;
+        jhi = s_in->right < tam ? s_in->right + 1 : tam;
+    }
+    if (s_out->pop) {
+        if (s_out->top < ilo) ilo = s_out->top;
+        if (s_out->bottom > ihi) ihi = s_out->bottom;
+        if (s_out->left < jlo) jlo = s_out->left;
+        if (s_out->right > jhi) jhi = s_out->right;
+    }
+
+    #pragma omp parallel for schedule(static) if(ihi - ilo >= CYCLE_PAR_ROWS) \
+        reduction(+:hash,pop) reduction(min:top,left) reduction(max:bottom,right)
+    for (i = ilo; i <= ihi; i++) {
+        uint64_t h;
+        int lo, hi;
+        long n = vida_linha_resumo(tabulIn, tabulOut, tam, i, jlo, jhi, pw->pb, &h, &lo, &hi);
+        if (n) {
+            hash += pw->pa[i] * h;
+            pop += n;
+            if (i < top) top = i;
+            if (i > bottom) bottom = i;
+            if (lo < left) left = lo;
+            if (hi > right) right = hi;
+        }
+    }
+    fechar_resumo(s, hash, pop, top, left, bottom, right, pw, tam);
+}
+
+// Compara o conteúdo da caixa de 's' com um padrão salvo (h x w)
+static int mesmo_padrao(const int* tabul, int tam, const resumo_t* s, const int* padrao) {
+    int i, w = s->right - s->left + 1;
+    for (i = s->top; i <= s->bottom; i++)
+        if (memcmp(tabul + ind2d(i, s->left), padrao + (size_t)(i - s->top)*w, w*sizeof(int)))
+            return 0;
+    return 1;
+}
+
+static void apagar_caixa(int* tabul, int tam, const resumo_t* s) {
+    int i;
+    for (i = s->top; i <= s->bottom && s->pop; i++)
+        memset(tabul + ind2d(i, s->left), 0, (s->right - s->left + 1)*sizeof(int));
+}
+
+// Períodos que um padrão que anda d por período pode saltar num eixo: o
+// envelope [o+lo, o+hi] do padrão ao longo do período, deslocado desde -d
+// (o período verificado) até k*d, deve ficar em 2..tam-1, para que nenhum
+// nascimento caia fora do tabuleiro e a evolução seja a mesma do plano
+// infinito. Retorna no máximo kmax; <= 0 se não há salto possível.
+static long periodos_no_eixo(int o, int lo, int hi, int d, int tam, long kmax) {
+    long k;
+    if (o + lo - (d > 0 ? d : 0) < 2 || o + hi - (d < 0 ? d : 0) > tam - 1)
+        return 0;
+    if (d > 0) k = (tam - 1 - o - hi) / d;
+    else if (d < 0) k = (o + lo - 2) / -d;
+    else k = kmax;
+    return k < kmax ? k : kmax;
+}
+
+// Executar um tamanho varrendo só a caixa envolvente do padrão e
+// procurando ciclos: quando o padrão normalizado (hash, população e
+// dimensões da caixa) se repete depois de p <= CYCLE_MAX_PERIOD gerações,
+// o próximo período é simulado e comparado célula a célula; confirmado o
+// ciclo, salta-se direto para a última repetição possível. Padrões
+// parados e osciladores saltam até o fim; naves (deslocamento não nulo)
+// são transladadas até onde a borda ainda não interfere, e o restante é
+// simulado normalmente. Correto avalia sempre o tabuleiro final real.
+int run_size_cycle(int tam, size_result_t* r, cycle_info_t* info) {
+    struct { uint64_t hash; long pop, gen; int top, left, h, w; } hist[CYCLE_MAX_PERIOD];
+    int *tabulIn, *tabulOut, *tmp, *padrao = NULL;
+    potencias_t pw;
+    resumo_t atual, anterior, proxima, inicio;
+    long g, total = 4L*(tam-3), simuladas = 0, cand_g = 0, p;
+    int k, candidato = 0, procurar = 1, cand_p = 0, di = 0, dj = 0;
+    int env_top = 0, env_bottom = 0, env_left = 0, env_right = 0;
+    uint64_t inv_a = inverso64(CYCLE_HASH_A), inv_b = inverso64(CYCLE_HASH_B);
+    double t0, t1, t2, t3;
+
+    memset(info, 0, sizeof(*info));
+    t0 = wall_time();
+    tabulIn = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    tabulOut = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    pw.pa = (uint64_t*)malloc((tam+2)*sizeof(uint64_t));
+    pw.pb = (uint64_t*)malloc((tam+2)*sizeof(uint64_t));
+    pw.ia = (uint64_t*)malloc((tam+2)*sizeof(uint64_t));
+    pw.ib = (uint64_t*)malloc((tam+2)*sizeof(uint64_t));
+    if (!tabulIn || !tabulOut || !pw.pa || !pw.pb || !pw.ia || !pw.ib) {
+        board_release(tabulIn);
+        board_release(tabulOut);
+        free(pw.pa); free(pw.pb); free(pw.ia); free(pw.ib);
+        return 0;
+    }
+    pw.pa[0] = pw.pb[0] = pw.ia[0] = pw.ib[0] = 1;
+    for (k = 1; k < tam+2; k++) {
+        pw.pa[k] = pw.pa[k-1] * CYCLE_HASH_A;
+        pw.pb[k] = pw.pb[k-1] * CYCLE_HASH_B;
+        pw.ia[k] = pw.ia[k-1] * inv_a;
+        pw.ib[k] = pw.ib[k-1] * inv_b;
+    }
+
+    for (k = 0; k < CYCLE_MAX_PERIOD; k++) hist[k].gen = -1;
+
+    InitGlider(tabulIn, tam);
+    resumir(tabulIn, tam, &pw, &atual);
+    fechar_resumo(&anterior, 0, 0, 0, 0, 0, 0, &pw, tam);
+    t1 = wall_time();
+
+    for (g = 0; g < total; ) {
+        if (candidato) {
+            // Envelope do padrão ao longo do período, relativo ao início
+            if (atual.top - inicio.top < env_top) env_top = atual.top - inicio.top;
+            if (atual.bottom - inicio.top > env_bottom) env_bottom = atual.bottom - inicio.top;
+            if (atual.left - inicio.left < env_left) env_left = atual.left - inicio.left;
+            if (atual.right - inicio.left > env_right) env_right = atual.right - inicio.left;
+        }
+        if (candidato && g == cand_g + cand_p) {
+            candidato = 0;
+            if (atual.pop == inicio.pop && atual.hash == inicio.hash &&
+                atual.bottom - atual.top == inicio.bottom - inicio.top &&
+                atual.right - atual.left == inicio.right - inicio.left &&
+                atual.top - inicio.top == di && atual.left - inicio.left == dj &&
+                mesmo_padrao(tabulIn, tam, &atual, padrao)) {
+                long n = (total - g) / cand_p;
+                procurar = 0;
+                info->period = cand_p;
+                info->di = di;
+                info->dj = dj;
+                info->detected = g;
+                if (di == 0 && dj == 0) {
+                    // O tabuleiro inteiro se repete: a borda não interfere
+                    info->kind = cand_p == 1 ? CYCLE_STILL : CYCLE_OSCILLATOR;
+                } else {
+                    long ni = periodos_no_eixo(atual.top, env_top, env_bottom, di, tam, n);
+                    long nj = periodos_no_eixo(atual.left, env_left, env_right, dj, tam, n);
+                    info->kind = CYCLE_SPACESHIP;
+                    n = ni < nj ? ni : nj;
+                    if (n > 0) {
+                        int i, w = atual.right - atual.left + 1;
+                        apagar_caixa(tabulIn, tam, &atual);
+                        apagar_caixa(tabulOut, tam, &anterior);
+                        fechar_resumo(&anterior, 0, 0, 0, 0, 0, 0, &pw, tam);
+                        atual.top += n*di; atual.bottom += n*di;
+                        atual.left += n*dj; atual.right += n*dj;
+                        for (i = atual.top; i <= atual.bottom; i++)
+                            memcpy(tabulIn + ind2d(i, atual.left),
+                                   padrao + (size_t)(i - atual.top)*w, w*sizeof(int));
+                    }
+                }
+                if (n > 0) {
+                    info->skipped = n * cand_p;
+                    g += info->skipped;
+                    if (run_checkpoint(g)) break;
+                    continue;
+                }
+            }
+        }
+
+        if (procurar && !candidato) {
+            // O menor período cujo padrão normalizado coincide com o atual
+            for (p = 1; p <= CYCLE_MAX_PERIOD && p <= g; p++) {
+                int h = (int)((g - p) % CYCLE_MAX_PERIOD);
+                if (hist[h].gen == g - p && hist[h].hash == atual.hash && hist[h].pop == atual.pop &&
+                    hist[h].h == atual.bottom - atual.top && hist[h].w == atual.right - atual.left)
+                    break;
+            }
+            if (p <= CYCLE_MAX_PERIOD && p <= g) {
+                int h = (int)((g - p) % CYCLE_MAX_PERIOD);
+                int w = atual.pop ? atual.right - atual.left + 1 : 0;
+                int* t = realloc(padrao, ((size_t)(atual.bottom - atual.top + 1)*w + 1)*sizeof(int));
+                if (t) {
+                    padrao = t;
+                    for (k = atual.top; k <= atual.bottom && atual.pop; k++)
+                        memcpy(padrao + (size_t)(k - atual.top)*w, tabulIn + ind2d(k, atual.left),
+                               w*sizeof(int));
+                    candidato = 1;
+                    cand_p = (int)p;
+                    di = atual.pop ? atual.top - hist[h].top : 0;
+                    dj = atual.pop ? atual.left - hist[h].left : 0;
+                    inicio = atual;
+                    cand_g = g;
+                    env_top = env_left = 0;
+                    env_bottom = atual.bottom - atual.top;
+                    env_right = atual.right - atual.left;
+                }
+            }
+        }
+        if (procurar) {
+            k = (int)(g % CYCLE_MAX_PERIOD);
+            hist[k].hash = atual.hash;
+            hist[k].pop = atual.pop;
+            hist[k].gen = g;
+            hist[k].top = atual.top;
+            hist[k].left = atual.left;
+            hist[k].h = atual.bottom - atual.top;
+            hist[k].w = atual.right - atual.left;
+        }
+
+        vida_resumo(tabulIn, tabulOut, tam, &atual, &anterior, &pw, &proxima);
+        anterior = atual;
+        atual = proxima;
+        tmp = tabulIn; tabulIn = tabulOut; tabulOut = tmp;
+        g++;
+        simuladas++;
+        if (run_checkpoint(g)) break;
+    }
+    t2 = wall_time();
+
+    r->correct = Correto(tabulIn, tam);
+    t3 = wall_time();
+
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    r->work = total > 0 ? (double)simuladas / total : 1.0;
+    board_release(tabulIn);
+    board_release(tabulOut);
+    free(pw.pa); free(pw.pb); free(pw.ia); free(pw.ib);
+    free(padrao);
+    return 1;
+}
@@ -0,0 +1,105 @@
+#ifndef GAME_OF_LIFE_H
+#define GAME_OF_LIFE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Tabuleiro de int com borda: (tam+2) x (tam+2), linhas/colunas 0 e tam+1 mortas
+#define ind2d(i,j) (i)*(tam+2)+j
+
+// Tabuleiro compactado: 64 células por palavra, linha com (tam+2) colunas
+// arredondada para palavras inteiras. A célula (i,j) é o bit j%64 da
+// palavra j/64 da linha i; bordas (linhas/colunas 0 e tam+1) ficam em zero.
+#define packed_words(tam) (((tam)+2+63)/64)
+
+static inline int packed_get(const uint64_t* tabul, int tam, int i, int j) {
+    return (tabul[(size_t)i*packed_words(tam) + j/64] >> (j%64)) & 1;
+}
+
+static inline void packed_set(uint64_t* tabul, int tam, int i, int j) {
+    tabul[(size_t)i*packed_words(tam) + j/64] |= 1ULL << (j%64);
+}
+
+typedef struct {
+    int correct;      // 1/0; -1 quando Correto não se aplica (regras sem o glider, life_rules.h)
+    double init, comp, check;
+    double work;      // fração das células (run_size_active) ou gerações (run_size_cycle) calculadas
+} size_result_t;
+
+// Regiões ativas: lado do bloco rastreado e limiar para varreduras completas
+#define ACTIVE_TILE 64
+#define ACTIVE_DENSE_FRACTION 0.5
+#define ACTIVE_DENSE_GENS 16
+
+// Detecção de ciclos: períodos procurados e, para padrões com mais linhas
+// que isso, a varredura da caixa envolvente é dividida entre as threads
+#define CYCLE_MAX_PERIOD 64
+#define CYCLE_PAR_ROWS 64
+
+// Atalho tomado por run_size_cycle
+typedef enum { CYCLE_NONE = 0, CYCLE_STILL, CYCLE_OSCILLATOR, CYCLE_SPACESHIP } cycle_kind_t;
+
+typedef struct {
+    cycle_kind_t kind;
+    int period;         // gerações por ciclo
+    int di, dj;         // deslocamento por período (linhas, colunas)
+    long detected;      // geração em que o ciclo foi confirmado
+    long skipped;       // gerações saltadas
+} cycle_info_t;
+
+// Kernels do tabuleiro de int: calculam as linhas ilo..ihi de tabulOut
+typedef void (*uma_vida_fn)(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi);
+
+typedef struct {
+    const char* name;
+    const char* cpu_feature;   // NULL = sempre suportado
+    uma_vida_fn fn;
+} vida_kernel_t;
+
+extern const vida_kernel_t vida_kernels[];
+extern const int num_vida_kernels;
+extern const vida_kernel_t* vida_kernel;   // kernel escolhido por select_vida_kernel
+
+double wall_time(void);
+
+// Controle cooperativo do job em execução na thread: os laços de gerações
+// dos run_size_* publicam o progresso e param quando 'cancel' vira 1. Fora
+// de jobs assíncronos run_control é NULL e nada é verificado.
+typedef struct {
+    atomic_int cancel;
+    atomic_long generation;     // gerações concluídas do tam atual
+} run_control_t;
+
+extern __thread run_control_t* run_control;
+// Publica o progresso; retorna 1 se o job foi cancelado
+int run_checkpoint(long generation);
+
+void UmaVida(int* tabulIn, int* tabulOut, int tam);
+void UmaVidaFaixa(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi);
+void UmaVidaSSE4(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi);
+void UmaVidaAVX2(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi);
+void UmaVidaAVX512(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi);
+int kernel_supported(const vida_kernel_t* k);
+void select_vida_kernel(void);
+void InitGlider(int* tabulIn, int tam);
+void InitTabul(int* tabulIn, int* tabulOut, int tam);
+int Correto(int* tabul, int tam);
+
+void UmaVidaPacked(const uint64_t* tabulIn, uint64_t* tabulOut, int tam);
+void InitGliderPacked(uint64_t* tabulIn, int tam);
+void InitTabulPacked(uint64_t* tabulIn, uint64_t* tabulOut, int tam);
+int CorretoPacked(const uint64_t* tabul, int tam);
+
+// Retorna 0 se faltar memória para o buffer de bloco de alguma thread
+int UmaVidaTiled(int* tabulIn, int* tabulOut, int tam, int tile, int gens);
+
+// Executam um tamanho completo (2*(tam-3) pares de gerações) com
+// tabuleiros da arena (board_arena.h); retornam 0 se faltar memória
+int run_size_int(int tam, size_result_t* r);
+int run_size_packed(int tam, size_result_t* r);
+int run_size_tiled(int tam, int tile, int tblock, size_result_t* r);
+int run_size_active(int tam, size_result_t* r);
+int run_size_cycle(int tam, size_result_t* r, cycle_info_t* info);
+const char* cycle_kind_name(cycle_kind_t kind);
+
+#endif
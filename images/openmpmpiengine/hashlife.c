@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "hashlife.h"
+
+// Nós são referenciados por índice na arena (que pode ser realocada
+// durante a recursão), nunca por ponteiro guardado entre chamadas.
+#define HL_NONE 0xFFFFFFFFu
+#define HL_DEAD 0u     // folha morta (nível 0)
+#define HL_ALIVE 1u    // folha viva (nível 0)
+#define HL_MAX_LEVEL 62
+
+typedef struct {
+    uint32_t nw, ne, sw, se;   // filhos (nível - 1)
+    uint32_t next;             // encadeamento no índice hash / lista livre
+    uint32_t res;              // centro avançado 2^(nível-2) gerações
+    uint32_t pres;             // centro avançado 2^pres_j gerações
+    int8_t pres_j;
+    uint8_t level;
+    uint8_t mark;
+    uint64_t pop;
+} hl_node_t;
+
+struct hashlife {
+    hl_node_t* nodes;
+    uint32_t cap, used, free_head;
+    uint32_t* buckets;
+    uint32_t nbuckets;
+    unsigned long live, peak, gcs, max_nodes;
+    int oom;
+};
+
+#define N(h, i) ((h)->nodes[i])
+
+static uint32_t hl_hash(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    uint64_t x = nw * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ ne) * 0xC2B2AE3D27D4EB4FULL;
+    x = (x ^ sw) * 0x165667B19E3779F9ULL;
+    x = (x ^ se) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(x >> 32);
+}
+
+static void hl_rehash(hashlife_t* h, uint32_t nbuckets) {
+    uint32_t* b = (uint32_t*)malloc(nbuckets * sizeof(uint32_t));
+    uint32_t i;
+    if (!b) return;   // mantém o índice antigo; só fica mais lento
+    memset(b, 0xFF, nbuckets * sizeof(uint32_t));
+    for (i = 2; i < h->used; i++) {
+        hl_node_t* n = &N(h, i);
+        if (n->level == 0) continue;   // entrada da lista livre
+        uint32_t k = hl_hash(n->nw, n->ne, n->sw, n->se) & (nbuckets - 1);
+        n->next = b[k];
+        b[k] = i;
+    }
+    free(h->buckets);
+    h->buckets = b;
+    h->nbuckets = nbuckets;
+}
+
+static uint32_t hl_alloc(hashlife_t* h) {
+    uint32_t i;
+    if (h->free_head != HL_NONE) {
+        i = h->free_head;
+        h->free_head = N(h, i).next;
+        return i;
+    }
+    if (h->used == h->cap) {
+        uint32_t cap = h->cap * 2;
+        hl_node_t* nodes = (hl_node_t*)realloc(h->nodes, cap * sizeof(hl_node_t));
+        if (!nodes) {
+            h->oom = 1;
+            return HL_NONE;
+        }
+        h->nodes = nodes;
+        h->cap = cap;
+    }
+    return h->used++;
+}
+
+// Nó canônico com os quatro filhos dados
+static uint32_t hl_join(hashlife_t* h, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    uint32_t k = hl_hash(nw, ne, sw, se) & (h->nbuckets - 1), i;
+    hl_node_t* n;
+
+    for (i = h->buckets[k]; i != HL_NONE; i = N(h, i).next) {
+        n = &N(h, i);
+        if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se)
+            return i;
+    }
+
+    i = hl_alloc(h);
+    if (i == HL_NONE) return HL_DEAD;
+    n = &N(h, i);
+    n->nw = nw; n->ne = ne; n->sw = sw; n->se = se;
+    n->level = N(h, nw).level + 1;
+    n->pop = N(h, nw).pop + N(h, ne).pop + N(h, sw).pop + N(h, se).pop;
+    n->res = HL_NONE;
+    n->pres = HL_NONE;
+    n->pres_j = -1;
+    n->mark = 0;
+    n->next = h->buckets[k];
+    h->buckets[k] = i;
+
+    h->live++;
+    if (h->live > h->peak) h->peak = h->live;
+    if (h->live > 2UL * h->nbuckets)
+        hl_rehash(h, h->nbuckets * 2);
+    return i;
+}
+
+static uint32_t hl_empty(hashlife_t* h, int level) {
+    uint32_t e = HL_DEAD;
+    int l;
+    for (l = 1; l <= level; l++)
+        e = hl_join(h, e, e, e, e);
+    return e;
+}
+
+// Quadrado central de nível k-1 de um nó de nível k
+static uint32_t hl_centro(hashlife_t* h, uint32_t n) {
+    uint32_t nw = N(h, n).nw, ne = N(h, n).ne, sw = N(h, n).sw, se = N(h, n).se;
+    return hl_join(h, N(h, nw).se, N(h, ne).sw, N(h, sw).ne, N(h, se).nw);
+}
+
+// Quadrados de nível k-1 centrados entre dois vizinhos horizontais/verticais
+static uint32_t hl_centro_h(hashlife_t* h, uint32_t w, uint32_t e) {
+    return hl_join(h, N(h, w).ne, N(h, e).nw, N(h, w).se, N(h, e).sw);
+}
+
+static uint32_t hl_centro_v(hashlife_t* h, uint32_t n, uint32_t s) {
+    return hl_join(h, N(h, n).sw, N(h, n).se, N(h, s).nw, N(h, s).ne);
+}
+
+// Caso base: nó 4x4 -> centro 2x2 após uma geração (B3/S23)
+static uint32_t hl_base(hashlife_t* h, uint32_t n) {
+    int g[4][4], i, j, out[2][2];
+    uint32_t q[4] = { N(h, n).nw, N(h, n).ne, N(h, n).sw, N(h, n).se };
+    for (i = 0; i < 4; i++) {
+        int oi = (i / 2) * 2, oj = (i % 2) * 2;
+        g[oi][oj] = N(h, q[i]).nw == HL_ALIVE;
+        g[oi][oj+1] = N(h, q[i]).ne == HL_ALIVE;
+        g[oi+1][oj] = N(h, q[i]).sw == HL_ALIVE;
+        g[oi+1][oj+1] = N(h, q[i]).se == HL_ALIVE;
+    }
+    for (i = 1; i <= 2; i++)
+        for (j = 1; j <= 2; j++) {
+            int v = g[i-1][j-1] + g[i-1][j] + g[i-1][j+1] + g[i][j-1] +
+                    g[i][j+1] + g[i+1][j-1] + g[i+1][j] + g[i+1][j+1];
+            out[i-1][j-1] = (v | g[i][j]) == 3;
+        }
+    return hl_join(h, out[0][0] ? HL_ALIVE : HL_DEAD, out[0][1] ? HL_ALIVE : HL_DEAD,
+                      out[1][0] ? HL_ALIVE : HL_DEAD, out[1][1] ? HL_ALIVE : HL_DEAD);
+}
+
+// Centro (nível k-1) do nó n (nível k) avançado 2^j gerações, 0 <= j <= k-2.
+// Com j = k-2 os dois estágios avançam tempo (velocidade máxima); com j
+// menor só o primeiro avança e o segundo apenas recorta os centros.
+static uint32_t hl_step(hashlife_t* h, uint32_t n, int j) {
+    int k = N(h, n).level, i;
+    uint32_t s[9], r[9], q[4], res;
+
+    if (N(h, n).pop == 0)
+        return N(h, n).nw;   // o filho de um nó vazio é o vazio de nível k-1
+    if (j == k-2 && N(h, n).res != HL_NONE)
+        return N(h, n).res;
+    if (j < k-2 && N(h, n).pres_j == j)
+        return N(h, n).pres;
+    if (k == 2) {
+        res = hl_base(h, n);
+        N(h, n).res = res;
+        return res;
+    }
+
+    uint32_t nw = N(h, n).nw, ne = N(h, n).ne, sw = N(h, n).sw, se = N(h, n).se;
+    s[0] = nw;
+    s[1] = hl_centro_h(h, nw, ne);
+    s[2] = ne;
+    s[3] = hl_centro_v(h, nw, sw);
+    s[4] = hl_centro(h, n);
+    s[5] = hl_centro_v(h, ne, se);
+    s[6] = sw;
+    s[7] = hl_centro_h(h, sw, se);
+    s[8] = se;
+
+    int j1 = j == k-2 ? k-3 : j;
+    for (i = 0; i < 9; i++)
+        r[i] = hl_step(h, s[i], j1);
+
+    q[0] = hl_join(h, r[0], r[1], r[3], r[4]);
+    q[1] = hl_join(h, r[1], r[2], r[4], r[5]);
+    q[2] = hl_join(h, r[3], r[4], r[6], r[7]);
+    q[3] = hl_join(h, r[4], r[5], r[7], r[8]);
+
+    for (i = 0; i < 4; i++)
+        q[i] = j == k-2 ? hl_step(h, q[i], k-3) : hl_centro(h, q[i]);
+    res = hl_join(h, q[0], q[1], q[2], q[3]);
+
+    if (j == k-2) {
+        N(h, n).res = res;
+    } else {
+        N(h, n).pres = res;
+        N(h, n).pres_j = j;
+    }
+    return res;
+}
+
+// Define a célula (x,y) relativa ao canto do nó n (nível 'level') como viva
+static uint32_t hl_set(hashlife_t* h, uint32_t n, int level, int64_t x, int64_t y) {
+    if (level == 0) return HL_ALIVE;
+    int64_t half = (int64_t)1 << (level - 1);
+    uint32_t nw = N(h, n).nw, ne = N(h, n).ne, sw = N(h, n).sw, se = N(h, n).se;
+    if (y < half) {
+        if (x < half) nw = hl_set(h, nw, level-1, x, y);
+        else ne = hl_set(h, ne, level-1, x - half, y);
+    } else {
+        if (x < half) sw = hl_set(h, sw, level-1, x, y - half);
+        else se = hl_set(h, se, level-1, x - half, y - half);
+    }
+    return hl_join(h, nw, ne, sw, se);
+}
+
+static int hl_get(const hashlife_t* h, uint32_t n, int level, int64_t x, int64_t y) {
+    int64_t size = (int64_t)1 << level;
+    if (x < 0 || y < 0 || x >= size || y >= size) return 0;
+    while (level > 0) {
+        int64_t half = (int64_t)1 << (level - 1);
+        if (N(h, n).pop == 0) return 0;
+        if (y < half) n = x < half ? N(h, n).nw : N(h, n).ne;
+        else n = x < half ? N(h, n).sw : N(h, n).se;
+        if (x >= half) x -= half;
+        if (y >= half) y -= half;
+        level--;
+    }
+    return n == HL_ALIVE;
+}
+
+// Envolve o nó num nó de nível k+1 com ele no centro
+static uint32_t hl_expand(hashlife_t* h, uint32_t n) {
+    uint32_t e = hl_empty(h, N(h, n).level - 1);
+    uint32_t nw = N(h, n).nw, ne = N(h, n).ne, sw = N(h, n).sw, se = N(h, n).se;
+    return hl_join(h, hl_join(h, e, e, e, nw), hl_join(h, e, e, ne, e),
+                      hl_join(h, e, sw, e, e), hl_join(h, se, e, e, e));
+}
+
+static void hl_mark(hashlife_t* h, uint32_t n) {
+    while (n > HL_ALIVE && !N(h, n).mark) {
+        N(h, n).mark = 1;
+        hl_mark(h, N(h, n).nw);
+        hl_mark(h, N(h, n).ne);
+        hl_mark(h, N(h, n).sw);
+        n = N(h, n).se;
+    }
+}
+
+// Coleta os nós inalcançáveis a partir de 'root'. Memos que apontam para
+// nós recolhidos são descartados; os demais continuam válidos.
+static void hl_gc(hashlife_t* h, uint32_t root) {
+    uint32_t i;
+    hl_mark(h, root);
+    for (i = 2; i < h->used; i++) {
+        hl_node_t* n = &N(h, i);
+        if (n->level == 0) continue;
+        if (!n->mark) {
+            n->level = 0;
+            n->next = h->free_head;
+            h->free_head = i;
+            h->live--;
+        }
+    }
+    for (i = 2; i < h->used; i++) {
+        hl_node_t* n = &N(h, i);
+        if (n->level == 0) continue;
+        if (n->res != HL_NONE && n->res > HL_ALIVE && !N(h, n->res).mark) n->res = HL_NONE;
+        if (n->pres != HL_NONE && n->pres > HL_ALIVE && !N(h, n->pres).mark) {
+            n->pres = HL_NONE;
+            n->pres_j = -1;
+        }
+    }
+    for (i = 2; i < h->used; i++)
+        N(h, i).mark = 0;
+    hl_rehash(h, h->nbuckets);
+    h->gcs++;
+}
+
+hashlife_t* hashlife_create(unsigned long max_nodes) {
+    hashlife_t* h = (hashlife_t*)calloc(1, sizeof(hashlife_t));
+    const char* env = getenv("HASHLIFE_MAX_NODES");
+    if (!h) return NULL;
+
+    h->max_nodes = max_nodes;
+    if (env && atol(env) > 0) h->max_nodes = (unsigned long)atol(env);
+    h->cap = 1 << 16;
+    h->nbuckets = 1 << 16;
+    h->nodes = (hl_node_t*)calloc(h->cap, sizeof(hl_node_t));
+    h->buckets = (uint32_t*)malloc(h->nbuckets * sizeof(uint32_t));
+    if (!h->nodes || !h->buckets) {
+        hashlife_destroy(h);
+        return NULL;
+    }
+    memset(h->buckets, 0xFF, h->nbuckets * sizeof(uint32_t));
+    h->free_head = HL_NONE;
+    // Folhas fixas: 0 = morta, 1 = viva
+    N(h, HL_ALIVE).pop = 1;
+    h->used = 2;
+    return h;
+}
+
+void hashlife_destroy(hashlife_t* hl) {
+    if (!hl) return;
+    free(hl->nodes);
+    free(hl->buckets);
+    free(hl);
+}
+
+void hashlife_get_stats(const hashlife_t* hl, hashlife_stats_t* stats) {
+    stats->nodes = hl->live;
+    stats->peak_nodes = hl->peak;
+    stats->gcs = hl->gcs;
+    stats->bytes = (double)hl->cap * sizeof(hl_node_t) + (double)hl->nbuckets * sizeof(uint32_t);
+}
+
+int run_size_hashlife(hashlife_t* h, int tam, size_result_t* r) {
+    double t0, t1, t2, t3;
+    int64_t ox = 0, oy = 0;   // coordenadas de tabuleiro do canto da raiz
+    int level = 1, j;
+    long gens = 4L*(tam-3);
+    uint32_t root;
+
+    t0 = wall_time();
+    while (((int64_t)1 << level) < tam + 2) level++;
+    root = hl_empty(h, level);
+    // Mesmo glider de InitTabul: (linha, coluna) = (y, x)
+    root = hl_set(h, root, level, 2, 1); root = hl_set(h, root, level, 3, 2);
+    root = hl_set(h, root, level, 1, 3); root = hl_set(h, root, level, 2, 3);
+    root = hl_set(h, root, level, 3, 3);
+    t1 = wall_time();
+
+    // Decomposição binária do número de gerações; cada passo de 2^j exige
+    // a raiz com nível >= j+3 e todo o padrão no quarto central, para que
+    // nada saia do centro devolvido por hl_step.
+    for (j = HL_MAX_LEVEL - 3; j >= 0 && !h->oom; j--) {
+        if (!(gens & (1L << j))) continue;
+        while (!h->oom && (N(h, root).level < j + 3 ||
+               N(h, hl_centro(h, hl_centro(h, root))).pop != N(h, root).pop)) {
+            int64_t q = (int64_t)1 << (N(h, root).level - 1);
+            root = hl_expand(h, root);
+            ox -= q; oy -= q;
+        }
+        int64_t q = (int64_t)1 << (N(h, root).level - 2);
+        root = hl_step(h, root, j);
+        ox += q; oy += q;
+
+        if (h->live > h->max_nodes)
+            hl_gc(h, root);
+        // Gerações já avançadas: os bits de 'gens' de j para cima
+        if (run_checkpoint(gens & ~((1L << j) - 1))) break;
+    }
+    t2 = wall_time();
+
+    if (h->oom) return 0;
+
+    // Correto sobre a árvore: população 5 e as células finais do glider
+    int lv = N(h, root).level;
+    r->correct = N(h, root).pop == 5 &&
+                 hl_get(h, root, lv, tam-1 - ox, tam-2 - oy) &&
+                 hl_get(h, root, lv, tam - ox, tam-1 - oy) &&
+                 hl_get(h, root, lv, tam-2 - ox, tam - oy) &&
+                 hl_get(h, root, lv, tam-1 - ox, tam - oy) &&
+                 hl_get(h, root, lv, tam - ox, tam - oy);
+    t3 = wall_time();
+
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    r->work = 0.0;
+    return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include "game_of_life.h"
+
+// HashLife: quadtree com nós canônicos (hash-consing) e resultados
+// memorizados por nó. Um contexto é criado por requisição e reaproveitado
+// entre os tamanhos, já que os nós não dependem da posição no tabuleiro.
+//
+// Simula o plano infinito: para padrões que nunca tocam a borda do
+// tabuleiro (como o glider de InitTabul) o resultado é idêntico ao do
+// tabuleiro com bordas mortas, e Correto é avaliado sobre a árvore final.
+
+// Limite padrão de nós vivos; acima dele os nós inalcançáveis são
+// recolhidos entre os passos (sobrescrito por HASHLIFE_MAX_NODES)
+#define HASHLIFE_DEFAULT_MAX_NODES (4UL << 20)
+
+typedef struct hashlife hashlife_t;
+
+typedef struct {
+    unsigned long nodes;        // nós vivos na tabela
+    unsigned long peak_nodes;   // maior número de nós já alocados
+    unsigned long gcs;          // coletas realizadas
+    double bytes;               // memória da tabela de nós e do índice hash
+} hashlife_stats_t;
+
+hashlife_t* hashlife_create(unsigned long max_nodes);
+void hashlife_destroy(hashlife_t* hl);
+void hashlife_get_stats(const hashlife_t* hl, hashlife_stats_t* stats);
+
+// Mesmo contrato dos run_size_*: 2*(tam-3) pares de gerações a partir do
+// glider de InitTabul; retorna 0 se faltar memória
+int run_size_hashlife(hashlife_t* hl, int tam, size_result_t* r);
+
+#endif
@@ -1,228 +1,1596 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stdarg.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <pthread.h>
-#include <sys/time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <signal.h>
 #include <omp.h>
+#include "game_of_life.h"
+#include "hashlife.h"
+#include "life_rules.h"
+#include "pattern.h"
+#include "board_arena.h"
+#include "core_sched.h"
+#include "result_cache.h"
+#include "metrics.h"
+#include "checkpoint.h"
 
 #define PORT 8081
 #define BUFFER_SIZE 2048
-#define ind2d(i,j) (i)*(tam+2)+j
-
-// Funções do Jogo da Vida
-double wall_time(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return(tv.tv_sec + tv.tv_usec/1000000.0);
-}
-
-void UmaVida(int* tabulIn, int* tabulOut, int tam) {
-    int i, j, vizviv;
-    
-    #pragma omp parallel for private(i, j, vizviv)
-    for (i=1; i<=tam; i++) {
-        for (j=1; j<=tam; j++) {
-            vizviv = tabulIn[ind2d(i-1,j-1)] + tabulIn[ind2d(i-1,j)] +
-                    tabulIn[ind2d(i-1,j+1)] + tabulIn[ind2d(i,j-1)] +
-                    tabulIn[ind2d(i,j+1)] + tabulIn[ind2d(i+1,j-1)] +
-                    tabulIn[ind2d(i+1,j)] + tabulIn[ind2d(i+1,j+1)];
-            
-            if (tabulIn[ind2d(i,j)] && vizviv < 2)
-                tabulOut[ind2d(i,j)] = 0;
-            else if (tabulIn[ind2d(i,j)] && vizviv > 3)
-                tabulOut[ind2d(i,j)] = 0;
-            else if (!tabulIn[ind2d(i,j)] && vizviv == 3)
-                tabulOut[ind2d(i,j)] = 1;
-            else
-                tabulOut[ind2d(i,j)] = tabulIn[ind2d(i,j)];
+#define MAX_EVENTS 64
+#define DEFAULT_WORKERS 2            // sobrescrito por ENGINE_WORKERS
+#define DEFAULT_QUEUE_CAPACITY 16    // sobrescrito por ENGINE_QUEUE
+#define RETRY_AFTER_SECONDS 2
+#define SCHED_SMALL_TAM 512         // jobs até este tam recebem um só núcleo
+#define MAX_ASYNC_JOBS 64           // jobs de /jobs guardados, em andamento ou terminados
+#define MIN_POW 3                   // limites de powmin/powmax, os do socket server
+#define MAX_POW 15
+#define PATTERN_CHUNK 65536         // pedaço do corpo de POST /process entregue ao parser
+
+// Modos de execução do engine (parâmetro engine= em /process)
+typedef enum {
+    MODE_INT = 0,     // uma célula por int (versão original)
+    MODE_PACKED,      // 64 células por uint64_t
+    MODE_TILED,       // blocos temporais sobre o tabuleiro de int
+    MODE_MPI,         // faixas de linhas entre ranks MPI (mpi_engine)
+    MODE_ACTIVE,      // só recalcula blocos com atividade
+    MODE_HASHLIFE,    // quadtree com memorização (hashlife.c)
+    MODE_CYCLE        // caixa envolvente com detecção de ciclos e salto de gerações
+} engine_mode_t;
+
+#define DEFAULT_TILE 256
+#define DEFAULT_TBLOCK 4
+#define DEFAULT_MPI_PROCS 2
+#define DEFAULT_MPIRUN "mpirun --allow-run-as-root --oversubscribe"
+#define DEFAULT_MPI_ENGINE "./mpi_engine"
+
+typedef struct {
+    int powmin;
+    int powmax;
+    engine_mode_t mode;
+    int tile;         // lado do bloco (MODE_TILED)
+    int tblock;       // gerações avançadas por bloco (MODE_TILED)
+    int np;           // número de ranks (MODE_MPI)
+    int threads;      // núcleos concedidos pelo escalonador
+    int cache;        // 0 com cache=bypass: recalcula e atualiza o cache
+    int stream;       // 1 com stream=ndjson: resposta chunked por tamanho
+    const vida_regra_t* regra;      // NULL se rule= não tem kernels
+    char rule[VIDA_REGRA_LEN];      // rule= como veio na query
+    int rule_given;                 // rule= veio na query (senão vale a do cabeçalho RLE)
+    // Tabuleiro único em vez do intervalo de tams com o glider: padrão do
+    // corpo de POST /process ou sopa aleatória (soup=SEMENTE)
+    pattern_parser_t* pattern;      // padrão já lido do corpo, ou NULL
+    int soup;
+    unsigned long seed;
+    double density;                 // fração de células vivas da sopa
+    int tam;                        // lado do tabuleiro (0 = automático)
+    int x, y;                       // canto do padrão no tabuleiro (-1 = automático)
+    long gens;                      // gerações (0 = 4*(tam-3), como no glider)
+    pattern_format_t format;
+    double body_time;               // leitura e parse do corpo, somados ao init
+    // Checkpoints do tabuleiro único (checkpoint.h)
+    char checkpoint[CKPT_NAME_LEN]; // checkpoint=NOME ou resume=NOME
+    int resume;                     // continua do checkpoint em vez de criar um
+    int outofcore;                  // 1: tabuleiro no arquivo mapeado, kernel compactado
+    double checkpoint_s;            // intervalo entre gravações (0 = CHECKPOINT_INTERVAL)
+} process_params_t;
+
+// Conexão acompanhada pelo laço de eventos até os cabeçalhos chegarem
+typedef struct {
+    int fd;
+    int len;
+    long discard;       // bytes do corpo de POST /jobs ainda por descartar
+    char buf[BUFFER_SIZE];
+} conn_t;
+
+// Estados de um job assíncrono de POST /jobs
+typedef enum { JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_FAILED, JOB_CANCELLED } job_state_t;
+
+// Job assíncrono: criado por POST /jobs, executado por um worker e
+// consultado por GET /jobs/{id} até ser despejado da tabela por um job
+// mais novo. Os campos são protegidos por jobs_mutex, exceto o progresso
+// e o pedido de cancelamento, que ficam em control.
+typedef struct {
+    long long id;               // 0 = posição livre
+    job_state_t state;
+    process_params_t params;
+    run_control_t control;
+    int current_tam;
+    int mpi_pid;                // mpirun em andamento (MODE_MPI), para o DELETE
+    double created, started, finished;
+    char* results;              // linhas NDJSON por tam, como em stream=ndjson
+    size_t len, cap;
+    char summary[640];          // linha {"done":true,...} ao terminar
+} async_job_t;
+
+async_job_t async_jobs[MAX_ASYNC_JOBS];
+// Os ids começam num valor aleatório de 62 bits (job_id_seed): com várias
+// réplicas atrás do Service, o id de um pod não coincide com o de outro
+long long next_job_id = 1;
+pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Job aguardando um worker: uma conexão de /process ou um job assíncrono
+typedef struct {
+    int socket;
+    char* request;
+    int keep_alive;     // devolver a conexão ao laço de eventos no fim
+    async_job_t* async; // não NULL: job de POST /jobs, sem conexão
+    double enqueued_at;
+} job_t;
+
+// Fila circular limitada compartilhada entre o laço de eventos e os workers
+typedef struct {
+    job_t* jobs;
+    int capacity, head, count;
+    int workers, busy;
+    unsigned long rejected;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+} job_queue_t;
+
+job_queue_t queue = { .mutex = PTHREAD_MUTEX_INITIALIZER, .not_empty = PTHREAD_COND_INITIALIZER };
+
+// epoll do laço de eventos; os workers devolvem conexões keep-alive a ele
+int epoll_fd = -1;
+
+// Séries de /metrics, registradas em register_metrics antes dos workers
+struct {
+    metric_t *req_process, *req_jobs, *req_health, *req_metrics, *req_not_found, *rejected;
+    metric_t *queue_wait, *core_wait, *processing;
+    metric_t *phase_init, *phase_comp, *phase_check;
+    metric_t *cell_rate, *cells, *sizes_computed, *sizes_cached;
+} metrics;
+
+void register_metrics(void) {
+    const char* req = "Requisicoes HTTP recebidas por endpoint";
+    metrics.req_process = metrics_counter("engine_requests_total", "endpoint=\"process\"", req);
+    metrics.req_jobs = metrics_counter("engine_requests_total", "endpoint=\"jobs\"", req);
+    metrics.req_health = metrics_counter("engine_requests_total", "endpoint=\"health\"", req);
+    metrics.req_metrics = metrics_counter("engine_requests_total", "endpoint=\"metrics\"", req);
+    metrics.req_not_found = metrics_counter("engine_requests_total", "endpoint=\"not_found\"", req);
+    metrics.rejected = metrics_counter("engine_rejected_total", NULL,
+                                       "Jobs recusados com 503 por fila cheia");
+    metrics.queue_wait = metrics_histogram("engine_queue_wait_seconds", NULL,
+                                           "Tempo do job na fila ate um worker", 1e-5);
+    metrics.core_wait = metrics_histogram("engine_core_wait_seconds", NULL,
+                                          "Espera pelos nucleos do escalonador", 1e-5);
+    metrics.processing = metrics_histogram("engine_processing_seconds", NULL,
+                                           "Tempo de execucao do intervalo de tamanhos", 1e-4);
+    const char* phase = "Tempo por fase de cada tamanho calculado";
+    metrics.phase_init = metrics_histogram("gol_phase_seconds", "phase=\"init\"", phase, 1e-6);
+    metrics.phase_comp = metrics_histogram("gol_phase_seconds", "phase=\"comp\"", phase, 1e-6);
+    metrics.phase_check = metrics_histogram("gol_phase_seconds", "phase=\"check\"", phase, 1e-6);
+    metrics.cell_rate = metrics_histogram("gol_cell_updates_per_second", NULL,
+                                          "Celulas atualizadas por segundo de comp, por tamanho", 1e6);
+    metrics.cells = metrics_counter("gol_cell_updates_total", NULL,
+                                    "Celulas atualizadas nos tamanhos calculados");
+    const char* sizes = "Tamanhos entregues, calculados ou vindos do cache";
+    metrics.sizes_computed = metrics_counter("gol_sizes_total", "source=\"computed\"", sizes);
+    metrics.sizes_cached = metrics_counter("gol_sizes_total", "source=\"cache\"", sizes);
+}
+
+const char* mode_name(engine_mode_t mode) {
+    switch (mode) {
+        case MODE_PACKED: return "packed";
+        case MODE_TILED:  return "tiled";
+        case MODE_MPI:    return "mpi";
+        case MODE_ACTIVE: return "active";
+        case MODE_HASHLIFE: return "hashlife";
+        case MODE_CYCLE:  return "cycle";
+        default:          return "int";
+    }
+}
+
+// Envia tudo, repetindo send em envios parciais
+void send_all(int socket, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(socket, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= n;
+    }
+}
+
+// Um chunk de Transfer-Encoding: chunked; len 0 encerra a resposta
+void send_chunk(int socket, const char* data, size_t len) {
+    char size_line[32];
+    snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    send_all(socket, size_line, strlen(size_line));
+    send_all(socket, data, len);
+    send_all(socket, "\r\n", 2);
+}
+
+// Acrescenta uma linha NDJSON aos resultados de um job assíncrono
+void job_append(async_job_t* job, const char* data, size_t len) {
+    pthread_mutex_lock(&jobs_mutex);
+    if (job->len + len + 1 > job->cap) {
+        size_t cap = job->cap ? job->cap : 1024;
+        while (cap < job->len + len + 1) cap *= 2;
+        char* results = realloc(job->results, cap);
+        if (results) {
+            job->results = results;
+            job->cap = cap;
         }
     }
+    if (job->len + len + 1 <= job->cap) {
+        memcpy(job->results + job->len, data, len);
+        job->len += len;
+        job->results[job->len] = '\0';
+    }
+    pthread_mutex_unlock(&jobs_mutex);
 }
 
-void InitTabul(int* tabulIn, int* tabulOut, int tam) {
-    int ij;
-    for (ij=0; ij<(tam+2)*(tam+2); ij++) {
-        tabulIn[ij] = 0;
-        tabulOut[ij] = 0;
+// Tam em execução, para o progresso de GET /jobs/{id}
+void job_progress(async_job_t* job, int tam) {
+    pthread_mutex_lock(&jobs_mutex);
+    job->current_tam = tam;
+    atomic_store(&job->control.generation, 0);
+    pthread_mutex_unlock(&jobs_mutex);
+}
+
+// Destino dos resultados de cada tam: com stream, cada tamanho vira uma
+// linha NDJSON enviada num chunk assim que termina; num job assíncrono a
+// mesma linha fica guardada no job; nos demais casos as linhas são
+// acumuladas no texto de details, que cresce conforme necessário
+typedef struct {
+    int stream;
+    int socket;
+    async_job_t* job;
+    char* text;
+    size_t len, cap;
+    double total_time;      // soma dos tempos por tamanho
+    long gens;              // gerações por tamanho, se não forem 4*(tam-3)
+} result_sink_t;
+
+void sink_append(result_sink_t* sink, const char* fmt, ...) {
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (sink->len + n + 1 > sink->cap) {
+        size_t cap = sink->cap ? sink->cap : 1024;
+        while (cap < sink->len + n + 1) cap *= 2;
+        char* text = realloc(sink->text, cap);
+        if (!text) return;
+        sink->text = text;
+        sink->cap = cap;
+    }
+    va_start(ap, fmt);
+    vsnprintf(sink->text + sink->len, sink->cap - sink->len, fmt, ap);
+    va_end(ap);
+    sink->len += n;
+}
+
+// Copia 'src' escapado para dentro de uma string JSON; se não couber, é
+// cortado sem partir um escape
+void json_escape(char* dst, size_t size, const char* src) {
+    size_t pos = 0;
+    for (; *src; src++) {
+        unsigned char c = (unsigned char)*src;
+        char esc[8];
+        int n;
+        if (c == '"' || c == '\\') n = snprintf(esc, sizeof(esc), "\\%c", c);
+        else if (c == '\n') n = snprintf(esc, sizeof(esc), "\\n");
+        else if (c < 0x20) n = snprintf(esc, sizeof(esc), "\\u%04x", c);
+        else { esc[0] = c; n = 1; }
+        if (pos + n >= size) break;
+        memcpy(dst + pos, esc, n);
+        pos += n;
     }
-    tabulIn[ind2d(1,2)] = 1; tabulIn[ind2d(2,3)] = 1;
-    tabulIn[ind2d(3,1)] = 1; tabulIn[ind2d(3,2)] = 1;
-    tabulIn[ind2d(3,3)] = 1;
+    dst[pos] = '\0';
 }
 
-int Correto(int* tabul, int tam) {
-    int ij, cnt = 0;
-    for (ij=0; ij<(tam+2)*(tam+2); ij++)
-        cnt += tabul[ij];
-    return (cnt == 5 && tabul[ind2d(tam-2,tam-1)] &&
-            tabul[ind2d(tam-1,tam)] && tabul[ind2d(tam,tam-2)] &&
-            tabul[ind2d(tam,tam-1)] && tabul[ind2d(tam,tam)]);
+// Linha livre (erros, saída do mpirun), escapada aqui: mensagens de erro
+// trazem trechos do pedido, como o byte inválido de um padrão
+void sink_line(result_sink_t* sink, const char* text) {
+    char line[448];
+    json_escape(line, sizeof(line), text);
+    if (sink->stream || sink->job) {
+        char json[512];
+        int n = snprintf(json, sizeof(json), "{\"log\":\"%s\"}\n", line);
+        if (n >= (int)sizeof(json)) n = sizeof(json) - 1;
+        if (sink->job)
+            job_append(sink->job, json, n);
+        else
+            send_chunk(sink->socket, json, n);
+    } else {
+        sink_append(sink, "%s\\n", line);
+    }
+}
+
+// Fases e vazão de um tam; resultados do cache só contam como entregues.
+// Cada tam roda 4*(tam-3) gerações sobre tam*tam células.
+void record_size_metrics(int tam, long gens, const size_result_t* r, int cached) {
+    double cells = (gens > 0 ? (double)gens : 4.0 * (tam - 3)) * (double)tam * tam;
+
+    if (cached) {
+        metrics_add(metrics.sizes_cached, 1);
+        return;
+    }
+    metrics_add(metrics.sizes_computed, 1);
+    metrics_add(metrics.cells, cells);
+    metrics_observe(metrics.phase_init, r->init);
+    metrics_observe(metrics.phase_comp, r->comp);
+    metrics_observe(metrics.phase_check, r->check);
+    if (r->comp > 0)
+        metrics_observe(metrics.cell_rate, cells / r->comp);
+}
+
+// Resultado de um tam; 'extra' é o sufixo ", chave=valor, ..." do modo
+void sink_size(result_sink_t* sink, int tam, const size_result_t* r, const char* extra, int cached) {
+    double total = r->init + r->comp + r->check;
+    sink->total_time += total;
+    record_size_metrics(tam, sink->gens, r, cached);
+
+    if (sink->stream || sink->job) {
+        char json[512];
+        int n = snprintf(json, sizeof(json),
+                "{\"tam\":%d,\"correct\":%s,\"init\":%.7f,\"comp\":%.7f,\"check\":%.7f,"
+                "\"total\":%.7f,\"cache\":%s,\"extra\":\"%s\"}\n",
+                tam, r->correct < 0 ? "null" : r->correct ? "true" : "false", r->init, r->comp, r->check, total,
+                cached ? "true" : "false", strncmp(extra, ", ", 2) == 0 ? extra + 2 : extra);
+        if (n >= (int)sizeof(json)) n = sizeof(json) - 1;
+        if (sink->job)
+            job_append(sink->job, json, n);
+        else
+            send_chunk(sink->socket, json, n);
+    } else {
+        sink_append(sink, "tam=%d: %s - init=%.7f, comp=%.7f, check=%.7f, total=%.7f%s%s\\n",
+                    tam, r->correct < 0 ? "SEM GABARITO" : r->correct ? "CORRETO" : "ERRADO",
+                    r->init, r->comp, r->check, total, extra, cached ? ", cache=hit" : "");
+    }
+}
+
+// Executar o intervalo com o engine MPI. O comando de lançamento vem de
+// MPIRUN (ex.: "mpirun --hostfile /etc/mpi/hosts" para vários nós) e o
+// binário de MPI_ENGINE; cada linha "tam=..." impressa pelo rank 0 é
+// repassada ao sink assim que o mpirun a imprime. O shell imprime o
+// próprio PID antes do exec, para que um job cancelado possa encerrar o
+// mpirun (que repassa o sinal aos ranks).
+int execute_mpi(const process_params_t* params, result_sink_t* sink) {
+    const char* mpirun = getenv("MPIRUN");
+    const char* binary = getenv("MPI_ENGINE");
+    char cmd[512], line[256];
+    int success = 1, seen = 0, pid = 0;
+    FILE* out;
+
+    // Os núcleos concedidos são divididos entre os ranks locais
+    int omp_threads = params->threads / params->np;
+    snprintf(cmd, sizeof(cmd), "echo $$; exec env OMP_NUM_THREADS=%d %s -np %d %s %d %d 2>&1",
+             omp_threads > 0 ? omp_threads : 1, mpirun ? mpirun : DEFAULT_MPIRUN, params->np,
+             binary ? binary : DEFAULT_MPI_ENGINE, params->powmin, params->powmax);
+    printf("Lançando engine MPI: %s\n", cmd);
+
+    out = popen(cmd, "r");
+    if (!out) {
+        sink_line(sink, "ERRO: Falha ao lançar mpirun");
+        return 0;
+    }
+    if (fgets(line, sizeof(line), out))
+        pid = atoi(line);
+    if (sink->job) {
+        pthread_mutex_lock(&jobs_mutex);
+        sink->job->mpi_pid = pid;
+        pthread_mutex_unlock(&jobs_mutex);
+        // Cancelado antes de o PID ser conhecido
+        if (pid > 0 && atomic_load(&sink->job->control.cancel))
+            kill(pid, SIGTERM);
+    }
+
+    while (fgets(line, sizeof(line), out)) {
+        char status[16];
+        size_result_t r;
+        double total;
+        char* c;
+        int tam;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        // A saída vai dentro de uma string JSON
+        for (c = line; *c; c++)
+            if (*c == '"' || *c == '\\') *c = '\'';
+
+        if (sscanf(line, "tam=%d: %15s - init=%lf, comp=%lf, check=%lf, total=%lf",
+                   &tam, status, &r.init, &r.comp, &r.check, &total) == 6) {
+            r.correct = strcmp(status, "CORRETO") == 0;
+            r.work = 0.0;
+            seen++;
+            if (!r.correct) success = 0;
+            sink_size(sink, tam, &r, "", 0);
+        } else {
+            sink_line(sink, line);
+        }
+    }
+
+    if (sink->job) {
+        pthread_mutex_lock(&jobs_mutex);
+        sink->job->mpi_pid = 0;
+        pthread_mutex_unlock(&jobs_mutex);
+    }
+    if (pclose(out) != 0 || seen != params->powmax - params->powmin + 1)
+        success = 0;
+    return success;
+}
+
+// Chave do cache de resultados para um tam; os tempos dependem do kernel
+// e, no modo tiled, da geometria dos blocos
+void cache_key(const process_params_t* params, int tam, char* key, size_t size) {
+    if (params->regra != VIDA_REGRA_CONWAY)
+        snprintf(key, size, "mode=%s,rule=%s,kernel=%s,tam=%d",
+                 mode_name(params->mode), params->regra->name, vida_kernel->name, tam);
+    else if (params->mode == MODE_TILED)
+        snprintf(key, size, "mode=%s,kernel=%s,tam=%d,tile=%d,tblock=%d",
+                 mode_name(params->mode), vida_kernel->name, tam, params->tile, params->tblock);
+    else
+        snprintf(key, size, "mode=%s,kernel=%s,tam=%d",
+                 mode_name(params->mode), vida_kernel->name, tam);
+}
+
+// Erro de execute_board: fecha o checkpoint aberto e devolve 0
+int board_error(result_sink_t* sink, ckpt_t* ckpt, const char* msg) {
+    if (ckpt)
+        ckpt_close(ckpt);
+    sink_line(sink, msg);
+    return 0;
+}
+
+// Executa um tabuleiro único: o padrão lido do corpo do POST, uma sopa ou
+// um checkpoint retomado com resume=. Com checkpoint= (ou resume=) o
+// tabuleiro é gravado em $CHECKPOINT_DIR a cada intervalo e ao parar; com
+// outofcore=1 ele vive no próprio arquivo mapeado e roda com o kernel
+// compactado. Não há gabarito; a linha traz a população e o hash da
+// geração final.
+int execute_board(const process_params_t* params, result_sink_t* sink) {
+    char msg[384], extra[320];
+    size_result_t r;
+    long inicial = 0, pop, gens = 0, start = 0;
+    uint64_t hash;
+    int *tabul = NULL, tam, ok, saves = 0;
+    int fora = params->outofcore;
+    const vida_regra_t* regra = params->regra;
+    ckpt_t ckpt, *ck = NULL;
+    double t0 = wall_time();
+
+    if (params->pattern && params->pattern->error[0]) {
+        snprintf(msg, sizeof(msg), "ERRO: Padrão inválido: %s", params->pattern->error);
+        sink_line(sink, msg);
+        return 0;
+    }
+    if (params->mode != MODE_INT) {
+        sink_line(sink, "ERRO: Padrões e sopas só são suportados com engine=int");
+        return 0;
+    }
+    if (fora && !params->checkpoint[0]) {
+        sink_line(sink, "ERRO: outofcore=1 exige checkpoint=NOME (o tabuleiro fica no arquivo)");
+        return 0;
+    }
+    if (params->resume) {
+        if (ckpt_open(&ckpt, params->checkpoint) < 0) {
+            snprintf(msg, sizeof(msg), "ERRO: Checkpoint: %s", ckpt.error);
+            return board_error(sink, NULL, msg);
+        }
+        ck = &ckpt;
+        tam = ckpt.hdr->tam;
+        start = ckpt.hdr->generation;
+        inicial = ckpt.hdr->initial_population;
+        gens = params->gens > 0 ? params->gens : ckpt.hdr->gens;
+        regra = vida_regra_parse(ckpt.hdr->rule);
+        if (!regra || (params->rule_given && regra != params->regra)) {
+            snprintf(msg, sizeof(msg), "ERRO: Checkpoint %s usa a regra %s", params->checkpoint, ckpt.hdr->rule);
+            return board_error(sink, ck, msg);
+        }
+        // Acima do tabuleiro de int permitido, só fora do núcleo
+        if (tam > PATTERN_MAX_TAM)
+            fora = 1;
+        if (!fora) {
+            tabul = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+            if (!tabul) {
+                snprintf(msg, sizeof(msg), "ERRO: Falha na alocação para tam=%d", tam);
+                return board_error(sink, ck, msg);
+            }
+            ckpt_load_int(ck, tabul);
+        }
+    } else if (params->pattern) {
+        tabul = params->pattern->tabul;
+        tam = params->pattern->tam;
+        inicial = params->pattern->alive;
+    } else {
+        int max = fora ? CKPT_MAX_TAM : PATTERN_MAX_TAM;
+        tam = params->tam > 0 ? params->tam : PATTERN_DEFAULT_TAM;
+        if (tam < 4 || tam > max) {
+            snprintf(msg, sizeof(msg), "ERRO: tam=%d fora de 4-%d", tam, max);
+            sink_line(sink, msg);
+            return 0;
+        }
+        // Fora do núcleo a sopa é escrita direto no arquivo, mais abaixo
+        if (!fora) {
+            tabul = pattern_soup(tam, params->seed, params->density, &inicial);
+            if (!tabul) {
+                snprintf(msg, sizeof(msg), "ERRO: Falha na alocação para tam=%d", tam);
+                sink_line(sink, msg);
+                return 0;
+            }
+        }
+    }
+    if (!params->resume)
+        gens = params->gens > 0 ? params->gens : 4L*(tam-3);
+    if (fora && regra != VIDA_REGRA_CONWAY) {
+        if (tabul && !params->pattern)
+            board_release(tabul);
+        return board_error(sink, ck, "ERRO: outofcore=1 só é suportado com a regra B3/S23");
+    }
+    
+    // Checkpoint novo: a geração 0 já fica gravada, para que um pod
+    // despejado antes do primeiro intervalo ainda possa ser retomado
+    if (params->checkpoint[0] && !params->resume) {
+        if (ckpt_create(&ckpt, params->checkpoint, tam, gens, regra->name) < 0) {
+            if (tabul && !params->pattern)
+                board_release(tabul);
+            snprintf(msg, sizeof(msg), "ERRO: Checkpoint: %s", ckpt.error);
+            return board_error(sink, NULL, msg);
+        }
+        ck = &ckpt;
+        if (tabul) {
+            ck->hdr->initial_population = inicial;
+            ckpt_save_int(ck, tabul, 0);
+        } else {
+            pattern_soup_packed(ck->slot[0], tam, params->seed, params->density, &inicial);
+            ck->hdr->initial_population = inicial;
+            ckpt_commit(ck, 0, 0);
+        }
+        // Fora do núcleo o tabuleiro de int do padrão não é mais usado
+        if (fora && tabul) {
+            if (!params->pattern)
+                board_release(tabul);
+            tabul = NULL;
+        }
+    }
+    if (ck)
+        ckpt_set_interval(ck, params->checkpoint_s);
+    double init = wall_time() - t0 + params->body_time;
+    
+    sink->gens = gens > start ? gens - start : 0;
+    if (sink->job)
+        job_progress(sink->job, tam);
+    if (fora) {
+        ok = ckpt_run_packed(ck, gens, &r, &pop, &hash);
+    } else {
+        ok = run_board(&tabul, tam, start, gens, regra, ck, &r, &pop, &hash);
+        // O tabuleiro final pode ser o outro buffer: o padrão passa a apontar para ele
+        if (params->pattern)
+            params->pattern->tabul = tabul;
+        else
+            board_release(tabul);
+    }
+    if (ck) {
+        saves = ck->saves;
+        ckpt_close(ck);
+    }
+    if (!ok) {
+        snprintf(msg, sizeof(msg), "ERRO: Falha na alocação para tam=%d", tam);
+        sink_line(sink, msg);
+        return 0;
+    }
+    if (run_control && atomic_load(&run_control->cancel))
+        return 0;
+    
+    r.init += init;
+    int n = snprintf(extra, sizeof(extra), ", geracoes=%ld, populacao_inicial=%ld, populacao=%ld, hash=%016llx",
+                     gens, inicial, pop, (unsigned long long)hash);
+    if (params->pattern && params->pattern->clipped)
+        n += snprintf(extra + n, sizeof(extra) - n, ", descartadas=%ld", params->pattern->clipped);
+    if (ck)
+        n += snprintf(extra + n, sizeof(extra) - n, ", checkpoint=%s, retomado_de=%ld, gravacoes=%d%s",
+                      params->checkpoint, start, saves, fora ? ", fora_do_nucleo=sim" : "");
+    sink_size(sink, tam, &r, extra, 0);
+    return 1;
 }
 
 // Executar Jogo da Vida para um intervalo de POWMIN a POWMAX
-int execute_game_of_life(int powmin, int powmax, char* result_buffer, int buffer_size) {
-    int pow, i, tam, *tabulIn, *tabulOut;
-    double t0, t1, t2, t3, total_time = 0.0;
+int execute_game_of_life(const process_params_t* params, result_sink_t* sink) {
+    int pow, tam;
     int success = 1;
-    int pos = 0;
+    hashlife_t* hl = NULL;
+    
+    // As outras regras só têm kernels para o tabuleiro de int
+    if (!params->regra || (params->regra != VIDA_REGRA_CONWAY && params->mode != MODE_INT)) {
+        char msg[512], regras[384];
+        vida_regras_list(regras, sizeof(regras));
+        if (!params->regra)
+            snprintf(msg, sizeof(msg), "ERRO: Regra %s sem kernels; suportadas: %s", params->rule, regras);
+        else
+            snprintf(msg, sizeof(msg), "ERRO: Regra %s só é suportada com engine=int", params->regra->name);
+        sink_line(sink, msg);
+        return 0;
+    }
+    
+    if (params->pattern || params->soup || params->resume)
+        return execute_board(params, sink);
     
-    pos += snprintf(result_buffer + pos, buffer_size - pos, 
-                   "OpenMP Engine Results (Threads: %d):\\n", omp_get_max_threads());
+    // O MPI roda o intervalo inteiro num só mpirun e fica fora do cache
+    if (params->mode == MODE_MPI)
+        return execute_mpi(params, sink);
     
-    for (pow = powmin; pow <= powmax; pow++) {
+    for (pow = params->powmin; pow <= params->powmax; pow++) {
+        char key[RESULT_CACHE_KEY_LEN];
+        cached_result_t cached;
+        size_result_t r;
+        cycle_info_t ciclo;
+        int ok;
         tam = 1 << pow;
         
-        t0 = wall_time();
-        tabulIn = (int*)malloc((tam+2)*(tam+2)*sizeof(int));
-        tabulOut = (int*)malloc((tam+2)*(tam+2)*sizeof(int));
+        if (sink->job)
+            job_progress(sink->job, tam);
+        cache_key(params, tam, key, sizeof(key));
+        if (params->cache && result_cache_get(key, &cached)) {
+            sink_size(sink, tam, &cached.r, cached.extra, 1);
+            if (cached.r.correct == 0) success = 0;
+            continue;
+        }
+        
+        // O contexto HashLife só é criado se algum tam não veio do cache
+        if (params->mode == MODE_HASHLIFE && !hl)
+            hl = hashlife_create(HASHLIFE_DEFAULT_MAX_NODES);
         
-        if (!tabulIn || !tabulOut) {
-            pos += snprintf(result_buffer + pos, buffer_size - pos,
-                           "ERRO: Falha na alocação para tam=%d\\n", tam);
+        if (params->mode == MODE_PACKED)
+            ok = run_size_packed(tam, &r);
+        else if (params->mode == MODE_TILED)
+            ok = run_size_tiled(tam, params->tile, params->tblock, &r);
+        else if (params->mode == MODE_ACTIVE)
+            ok = run_size_active(tam, &r);
+        else if (params->mode == MODE_HASHLIFE)
+            ok = hl && run_size_hashlife(hl, tam, &r);
+        else if (params->mode == MODE_CYCLE)
+            ok = run_size_cycle(tam, &r, &ciclo);
+        else if (params->regra != VIDA_REGRA_CONWAY)
+            ok = run_size_rule(tam, params->regra, &r);
+        else
+            ok = run_size_int(tam, &r);
+        
+        if (!ok) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "ERRO: Falha na alocação para tam=%d", tam);
+            sink_line(sink, msg);
             success = 0;
             break;
         }
         
-        InitTabul(tabulIn, tabulOut, tam);
-        t1 = wall_time();
-        
-        for (i = 0; i < 2*(tam-3); i++) {
-            UmaVida(tabulIn, tabulOut, tam);
-            UmaVida(tabulOut, tabulIn, tam);
+        // Job cancelado: o tam ficou pela metade e não vai para o cache
+        if (run_control && atomic_load(&run_control->cancel)) {
+            success = 0;
+            break;
         }
-        t2 = wall_time();
-        
-        int is_correct = Correto(tabulIn, tam);
-        t3 = wall_time();
-        
-        double iteration_time = t3 - t0;
-        total_time += iteration_time;
         
-        pos += snprintf(result_buffer + pos, buffer_size - pos,
-                       "tam=%d: %s - init=%.7f, comp=%.7f, check=%.7f, total=%.7f\\n",
-                       tam, is_correct ? "CORRETO" : "ERRADO", 
-                       t1-t0, t2-t1, t3-t2, iteration_time);
+        char extra[RESULT_CACHE_EXTRA_LEN] = "";
+        if (params->mode == MODE_ACTIVE) {
+            snprintf(extra, sizeof(extra), ", ativos=%.3f%%", 100.0*r.work);
+        } else if (params->mode == MODE_HASHLIFE) {
+            hashlife_stats_t st;
+            hashlife_get_stats(hl, &st);
+            snprintf(extra, sizeof(extra), ", nos=%lu, pico=%lu, memoria=%.1fMB, gc=%lu",
+                     st.nodes, st.peak_nodes, st.bytes / (1024.0*1024.0), st.gcs);
+        } else if (params->mode == MODE_CYCLE) {
+            snprintf(extra, sizeof(extra), ", atalho=%s, periodo=%d, desloc=(%d,%d), detectado=%ld, saltadas=%ld, simuladas=%.3f%%",
+                     cycle_kind_name(ciclo.kind), ciclo.period, ciclo.di, ciclo.dj,
+                     ciclo.detected, ciclo.skipped, 100.0*r.work);
+        }
         
-        if (!is_correct) success = 0;
+        sink_size(sink, tam, &r, extra, 0);
+        if (r.correct == 0) success = 0;
         
-        free(tabulIn);
-        free(tabulOut);
+        cached.r = r;
+        snprintf(cached.extra, sizeof(cached.extra), "%s", extra);
+        result_cache_put(key, &cached);
     }
     
-    pos += snprintf(result_buffer + pos, buffer_size - pos,
-                   "\\nTempo total: %.6f segundos", total_time);
-    
+    hashlife_destroy(hl);
     return success;
 }
 
+// Regra de rule= ou do cabeçalho RLE; o texto original vai de volta ao
+// cliente dentro de strings JSON
+void set_rule(process_params_t* params, const char* rulestring) {
+    char* c;
+    snprintf(params->rule, sizeof(params->rule), "%s", rulestring);
+    params->regra = vida_regra_parse(rulestring);
+    for (c = params->rule; *c; c++)
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) *c = '\'';
+}
+
 // Parsear query string HTTP
-void parse_query_params(char* query, int* powmin, int* powmax) {
-    *powmin = 3; *powmax = 6; // defaults
-    
+void parse_query_params(char* query, process_params_t* params) {
     char* token = strtok(query, "&");
     while (token != NULL) {
         if (strncmp(token, "powmin=", 7) == 0) {
-            *powmin = atoi(token + 7);
+            params->powmin = atoi(token + 7);
         } else if (strncmp(token, "powmax=", 7) == 0) {
-            *powmax = atoi(token + 7);
+            params->powmax = atoi(token + 7);
+        } else if (strncmp(token, "engine=", 7) == 0) {
+            if (strcmp(token + 7, "packed") == 0)
+                params->mode = MODE_PACKED;
+            else if (strcmp(token + 7, "tiled") == 0)
+                params->mode = MODE_TILED;
+            else if (strcmp(token + 7, "mpi") == 0)
+                params->mode = MODE_MPI;
+            else if (strcmp(token + 7, "active") == 0)
+                params->mode = MODE_ACTIVE;
+            else if (strcmp(token + 7, "hashlife") == 0)
+                params->mode = MODE_HASHLIFE;
+            else if (strcmp(token + 7, "cycle") == 0)
+                params->mode = MODE_CYCLE;
+            else
+                params->mode = MODE_INT;
+        } else if (strncmp(token, "tile=", 5) == 0) {
+            params->tile = atoi(token + 5);
+        } else if (strncmp(token, "tblock=", 7) == 0) {
+            params->tblock = atoi(token + 7);
+        } else if (strncmp(token, "np=", 3) == 0) {
+            params->np = atoi(token + 3);
+        } else if (strncmp(token, "cache=", 6) == 0) {
+            params->cache = strcmp(token + 6, "bypass") != 0;
+        } else if (strncmp(token, "stream=", 7) == 0) {
+            params->stream = strcmp(token + 7, "ndjson") == 0;
+        } else if (strncmp(token, "soup=", 5) == 0) {
+            params->soup = 1;
+            params->seed = strtoul(token + 5, NULL, 10);
+        } else if (strncmp(token, "density=", 8) == 0) {
+            params->density = atof(token + 8);
+        } else if (strncmp(token, "tam=", 4) == 0) {
+            params->tam = atoi(token + 4);
+        } else if (strncmp(token, "x=", 2) == 0) {
+            params->x = atoi(token + 2);
+        } else if (strncmp(token, "y=", 2) == 0) {
+            params->y = atoi(token + 2);
+        } else if (strncmp(token, "gens=", 5) == 0) {
+            params->gens = atol(token + 5);
+        } else if (strncmp(token, "format=", 7) == 0) {
+            params->format = strcmp(token + 7, "rle") == 0 ? PATTERN_RLE :
+                             strcmp(token + 7, "plain") == 0 ? PATTERN_PLAIN : PATTERN_AUTO;
+        } else if (strncmp(token, "checkpoint=", 11) == 0) {
+            snprintf(params->checkpoint, sizeof(params->checkpoint), "%s", token + 11);
+        } else if (strncmp(token, "resume=", 7) == 0) {
+            params->resume = 1;
+            snprintf(params->checkpoint, sizeof(params->checkpoint), "%s", token + 7);
+        } else if (strncmp(token, "outofcore=", 10) == 0) {
+            params->outofcore = atoi(token + 10) > 0;
+        } else if (strncmp(token, "checkpoint_s=", 13) == 0) {
+            params->checkpoint_s = atof(token + 13);
+        } else if (strncmp(token, "rule=", 5) == 0) {
+            params->rule_given = 1;
+            set_rule(params, token + 5);
         }
         token = strtok(NULL, "&");
     }
+    
+    // Blocos menores que 8 ou mais gerações que o lado do bloco desperdiçam
+    // mais trabalho redundante nas bordas do que economizam em cache; o
+    // bloco não passa do maior tabuleiro pedido
+    int tam_max = params->powmax > 0 && params->powmax < 31 ? 1 << params->powmax : 1 << 30;
+    if (params->tile < 8) params->tile = 8;
+    if (params->tile > tam_max) params->tile = tam_max;
+    if (params->tblock < 1) params->tblock = 1;
+    if (params->tblock > params->tile) params->tblock = params->tile;
+    if (params->np < 1) params->np = 1;
+    if (params->gens < 0) params->gens = 0;
+    if (params->density < 0.0) params->density = 0.0;
+    if (params->density > 1.0) params->density = 1.0;
 }
 
-void* handle_client(void* arg) {
-    int client_socket = *(int*)arg;
-    free(arg);
+// Núcleos pedidos ao escalonador: tabuleiros pequenos, o HashLife (que é
+// sequencial) e o cycle (que varre só a caixa do glider) não ganham nada
+// com uma equipe inteira, os demais usam todos
+int cores_for_job(const process_params_t* params) {
+    int tam = 1 << params->powmax;
+    if (params->pattern)
+        tam = params->pattern->tam;
+    else if (params->soup)
+        tam = params->tam > 0 ? params->tam : PATTERN_DEFAULT_TAM;
+    else if (params->resume)
+        tam = CKPT_MAX_TAM;     // o lado só é conhecido ao abrir o arquivo
+    if (params->mode == MODE_HASHLIFE || params->mode == MODE_CYCLE || tam <= SCHED_SMALL_TAM)
+        return 1;
+    return core_sched_total();
+}
+
+// HTTP/1.1 mantém a conexão por padrão; HTTP/1.0 só com keep-alive explícito
+int wants_keep_alive(const char* request) {
+    const char* line = strstr(request, "\r\n");
+    int keep = line && line - request >= 8 && strncmp(line - 8, "HTTP/1.1", 8) == 0;
     
-    char buffer[BUFFER_SIZE];
-    char response[4096];
-    char result_buffer[3072];
+    while (line && line[2] != '\r' && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char* v = line + 11;
+            while (*v == ' ') v++;
+            if (strncasecmp(v, "close", 5) == 0) keep = 0;
+            else if (strncasecmp(v, "keep-alive", 10) == 0) keep = 1;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return keep;
+}
+
+// Resposta com Content-Length, para que o cliente saiba onde ela termina
+// numa conexão keep-alive
+void send_response(int socket, const char* status, const char* content_type,
+                   const char* extra_headers, const char* body, size_t body_len, int keep_alive) {
+    char headers[512];
+    int n = snprintf(headers, sizeof(headers),
+            "HTTP/1.1 %s\r\n"
+            "Content-Type: %s\r\n"
+            "Access-Control-Allow-Origin: *\r\n"
+            "Content-Length: %zu\r\n"
+            "%s"
+            "Connection: %s\r\n"
+            "\r\n",
+            status, content_type, body_len, extra_headers, keep_alive ? "keep-alive" : "close");
+    send_all(socket, headers, n);
+    send_all(socket, body, body_len);
+}
+
+void send_json_response(int socket, const char* status, const char* extra_headers,
+                        const char* body, size_t body_len, int keep_alive) {
+    send_response(socket, status, "application/json", extra_headers, body, body_len, keep_alive);
+}
+
+// Respostas leves, respondidas direto no laço de eventos
+void build_health_body(char* body, size_t size) {
+    arena_stats_t arena;
+    core_sched_stats_t cores;
+    result_cache_stats_t cache;
+    board_arena_stats(&arena);
+    core_sched_stats(&cores);
+    result_cache_stats(&cache);
+    pthread_mutex_lock(&queue.mutex);
+    int queued = queue.count, busy = queue.busy;
+    pthread_mutex_unlock(&queue.mutex);
+    snprintf(body, size,
+            "{\"status\":\"healthy\",\"engine\":\"OpenMP\",\"threads\":%d,\"kernel\":\"%s\","
+            "\"workers\":%d,\"busy\":%d,\"queued\":%d,\"queue_capacity\":%d,\"rejected\":%lu,"
+            "\"cores\":{\"total\":%d,\"free\":%d,\"waiting\":%d,\"grants\":%lu},"
+            "\"cache\":{\"entries\":%d,\"capacity\":%d,\"hits\":%lu,\"misses\":%lu,\"persistent\":%s},"
+            "\"arena\":{\"buffers\":%d,\"in_use\":%d,\"bytes\":%.0f,\"reuses\":%lu,\"allocs\":%lu}}",
+            cores.total, vida_kernel->name,
+            queue.workers, busy, queued, queue.capacity, queue.rejected,
+            cores.total, cores.free, cores.waiting, cores.grants,
+            cache.entries, cache.capacity, cache.hits, cache.misses, cache.persistent ? "true" : "false",
+            arena.buffers, arena.in_use, arena.bytes, arena.reuses, arena.allocs);
+}
+
+// Texto do Prometheus: contadores e histogramas do módulo metrics mais os
+// gauges lidos na hora (fila, núcleos, cache, arena); malloc no chamador
+char* build_metrics_body(size_t* len) {
+    arena_stats_t arena;
+    core_sched_stats_t cores;
+    result_cache_stats_t cache;
+    size_t cap;
+    char* text = metrics_render(len, &cap);
+
+    board_arena_stats(&arena);
+    core_sched_stats(&cores);
+    result_cache_stats(&cache);
+    pthread_mutex_lock(&queue.mutex);
+    int queued = queue.count, busy = queue.busy;
+    pthread_mutex_unlock(&queue.mutex);
+    metrics_appendf(&text, len, &cap,
+            "# TYPE engine_workers gauge\nengine_workers %d\n"
+            "# TYPE engine_workers_busy gauge\nengine_workers_busy %d\n"
+            "# TYPE engine_queue_depth gauge\nengine_queue_depth %d\n"
+            "# TYPE engine_queue_capacity gauge\nengine_queue_capacity %d\n"
+            "# TYPE engine_cores gauge\nengine_cores %d\n"
+            "# TYPE engine_cores_free gauge\nengine_cores_free %d\n"
+            "# TYPE engine_cores_waiting gauge\nengine_cores_waiting %d\n"
+            "# TYPE engine_cache_entries gauge\nengine_cache_entries %d\n"
+            "# TYPE engine_cache_hits_total counter\nengine_cache_hits_total %lu\n"
+            "# TYPE engine_cache_misses_total counter\nengine_cache_misses_total %lu\n"
+            "# TYPE engine_arena_bytes gauge\nengine_arena_bytes %.0f\n",
+            queue.workers, busy, queued, queue.capacity,
+            cores.total, cores.free, cores.waiting,
+            cache.entries, cache.hits, cache.misses, arena.bytes);
+    return text;
+}
+
+void build_not_found_body(char* body, size_t size) {
+    snprintf(body, size,
+            "{\"error\":\"Not found\",\"endpoints\":[\"/process?powmin=X&powmax=Y[&engine=int|packed|tiled|mpi|active|hashlife|cycle&rule=B3/S23&tile=T&tblock=K&np=N&cache=bypass&stream=ndjson]\",\"/process?soup=SEED[&density=D&tam=T&gens=G&checkpoint=NOME&checkpoint_s=S&outofcore=1]\",\"/process?resume=NOME[&gens=G&outofcore=1]\",\"POST /process?gens=G[&tam=T&x=X&y=Y&format=rle|plain] (corpo RLE ou plaintext)\",\"POST /jobs?powmin=X&powmax=Y[&...]\",\"GET /jobs/{id}\",\"DELETE /jobs/{id}\",\"/health\",\"/metrics\"]}");
+}
+
+void build_busy_body(char* body, size_t size) {
+    snprintf(body, size,
+            "{\"error\":\"Fila de processamento cheia\",\"queue_capacity\":%d}",
+            queue.capacity);
+}
+
+// Parâmetros de /process e POST /jobs, a partir da query da linha de
+// requisição; o que não vier na query fica com o valor padrão. Retorna 0
+// se powmin/powmax estão fora de MIN_POW-MAX_POW ou invertidos: 1 << pow
+// só é definido e viável nesse intervalo.
+int parse_request_params(const char* request, process_params_t* params) {
+    const process_params_t defaults = { 3, 6, MODE_INT, DEFAULT_TILE, DEFAULT_TBLOCK, DEFAULT_MPI_PROCS, 1, 1, 0 };
+    const char* line_end = strstr(request, "\r\n");
+    const char* query_start = strchr(request, '?');
     
-    ssize_t bytes = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-    if (bytes <= 0) {
-        close(client_socket);
-        return NULL;
+    *params = defaults;
+    params->regra = VIDA_REGRA_CONWAY;
+    snprintf(params->rule, sizeof(params->rule), "%s", VIDA_REGRA_CONWAY->name);
+    params->density = PATTERN_DEFAULT_DENSITY;
+    params->x = params->y = -1;
+    if (query_start && (!line_end || query_start < line_end)) {
+        char query[256];
+        int len = strcspn(query_start + 1, " \r\n");
+        snprintf(query, sizeof(query), "%.*s", len, query_start + 1);
+        parse_query_params(query, params);
     }
+    return params->powmin >= MIN_POW && params->powmax <= MAX_POW && params->powmin <= params->powmax;
+}
+
+void build_bad_request_body(char* body, size_t size) {
+    snprintf(body, size, "{\"error\":\"powmin e powmax devem estar entre %d-%d, com powmin <= powmax\"}",
+             MIN_POW, MAX_POW);
+}
+
+// Espera os núcleos do job e executa o intervalo. O MPI recebe a máscara
+// inteira e deixa o mpirun distribuir os ranks, os demais modos fixam
+// thread a thread
+int run_with_cores(process_params_t* params, result_sink_t* sink,
+                   double* processing_time, double* wait_time) {
+    core_grant_t grant;
+    double wait_start = wall_time();
+    core_sched_acquire(cores_for_job(params), &grant);
+    *wait_time = wall_time() - wait_start;
+    metrics_observe(metrics.core_wait, *wait_time);
+    params->threads = grant.ncpus;
+    if (params->mode == MODE_MPI)
+        core_sched_bind_thread(&grant);
+    else
+        core_sched_pin_team(&grant);
     
-    buffer[bytes] = '\0';
-    printf("Recebido: %s\n", buffer);
+    if (!sink->stream && !sink->job && params->mode != MODE_MPI)
+        sink_append(sink, "OpenMP Engine Results (Threads: %d, Mode: %s, Kernel: %s):\\n",
+                    params->threads, mode_name(params->mode), vida_kernel->name);
     
-    // Verificar se é requisição HTTP GET /process
-    if (strncmp(buffer, "GET /process", 12) == 0) {
-        char* query_start = strstr(buffer, "?");
-        int powmin = 3, powmax = 6;
-        
-        if (query_start) {
-            char* query_end = strstr(query_start, " HTTP");
-            if (query_end) {
-                *query_end = '\0';
-                char query[256];
-                strcpy(query, query_start + 1);
-                parse_query_params(query, &powmin, &powmax);
-            }
+    double start_time = wall_time();
+    int success = execute_game_of_life(params, sink);
+    *processing_time = wall_time() - start_time;
+    core_sched_release(&grant);
+    metrics_observe(metrics.processing, *processing_time);
+    return success;
+}
+
+// Campos do resumo de /process e dos jobs assíncronos, sem as chaves
+void build_summary(char* out, size_t size, const process_params_t* params, int success,
+                   double processing_time, double wait_time) {
+    snprintf(out, size,
+            "\"success\":%s,"
+            "\"engine\":\"OpenMP\","
+            "\"powmin\":%d,"
+            "\"powmax\":%d,"
+            "\"mode\":\"%s\","
+            "\"kernel\":\"%s\","
+            "\"rule\":\"%s\","
+            "\"tile\":%d,"
+            "\"tblock\":%d,"
+            "\"processing_time\":%.6f,"
+            "\"wait_time\":%.6f,"
+            "\"threads\":%d",
+            success ? "true" : "false",
+            params->powmin, params->powmax, mode_name(params->mode),
+            vida_kernel->name, params->regra ? params->regra->name : params->rule,
+            params->tile, params->tblock, processing_time,
+            wait_time, params->threads);
+}
+
+// Valor de um cabeçalho (sem diferenciar maiúsculas), ou NULL
+const char* header_value(const char* request, const char* name) {
+    const char* line = strstr(request, "\r\n");
+    size_t n = strlen(name);
+    
+    while (line && line[2] != '\r' && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, name, n) == 0 && line[n] == ':') {
+            const char* v = line + n + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            return v;
         }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+// Lê o corpo de POST /process direto do socket para o tabuleiro, em
+// pedaços de PATTERN_CHUNK entregues ao parser incremental; o texto do
+// padrão nunca é guardado inteiro. Os primeiros bytes do corpo podem ter
+// chegado junto com os cabeçalhos, no fim de 'request'. Retorna 0 se o
+// corpo não foi lido até o fim: a conexão não pode ser reaproveitada.
+int read_pattern_body(int socket, const char* request, process_params_t* params) {
+    pattern_parser_t* parser = params->pattern;
+    const char* length = header_value(request, "Content-Length");
+    const char* expect = header_value(request, "Expect");
+    const char* body = strstr(request, "\r\n\r\n");
+    char chunk[PATTERN_CHUNK];
+    long total, fed;
+    double t0 = wall_time();
+    
+    if (!length || !body) {
+        snprintf(parser->error, sizeof(parser->error), "Content-Length obrigatório");
+        return 0;
+    }
+    total = atol(length);
+    body += 4;
+    fed = strlen(body) < (size_t)total ? (long)strlen(body) : total;
+    
+    // curl espera o 100 Continue antes de mandar corpos maiores
+    if (expect && strncasecmp(expect, "100-continue", 12) == 0 && fed < total)
+        send_all(socket, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+    
+    if (pattern_parser_feed(parser, body, fed) < 0)
+        return 0;
+    while (fed < total) {
+        size_t want = total - fed < (long)sizeof(chunk) ? (size_t)(total - fed) : sizeof(chunk);
+        ssize_t n = recv(socket, chunk, want, 0);
+        if (n <= 0) {
+            snprintf(parser->error, sizeof(parser->error), "Conexão encerrada com %ld de %ld bytes", fed, total);
+            return 0;
+        }
+        fed += n;
+        if (pattern_parser_feed(parser, chunk, n) < 0)
+            return 0;
+    }
+    if (pattern_parser_finish(parser) < 0)
+        return 1;
+    
+    // A regra do cabeçalho RLE vale se a query não escolheu outra
+    if (!params->rule_given && parser->rule[0])
+        set_rule(params, parser->rule);
+    params->body_time = wall_time() - t0;
+    printf("Padrão recebido: %ld bytes, tam=%d, %ld células vivas, %ld descartadas\n",
+           total, parser->tam, parser->alive, parser->clipped);
+    return 1;
+}
+
+// Executa /process num worker do pool; o socket já está em modo bloqueante.
+// Com stream=ndjson a resposta é chunked: um objeto JSON por tamanho assim
+// que ele termina e um resumo final com "done":true. POST /process traz o
+// padrão inicial no corpo. Retorna se a conexão pode ser reaproveitada.
+int handle_process(int client_socket, char* buffer, int keep_alive) {
+    process_params_t params;
+    result_sink_t sink = { 0 };
+    pattern_parser_t parser;
+    double processing_time, wait_time;
+    
+    if (!parse_request_params(buffer, &params)) {
+        char body[160];
+        build_bad_request_body(body, sizeof(body));
+        // Um corpo de POST /process não lido impede reaproveitar a conexão
+        if (strncmp(buffer, "POST ", 5) == 0)
+            keep_alive = 0;
+        send_json_response(client_socket, "400 Bad Request", "", body, strlen(body), keep_alive);
+        return keep_alive;
+    }
+    sink.stream = params.stream;
+    sink.socket = client_socket;
+    
+    // O corpo é lido antes de pedir núcleos: a transferência não os segura
+    if (strncmp(buffer, "POST ", 5) == 0) {
+        pattern_parser_init(&parser, params.format, params.tam, params.x, params.y);
+        params.pattern = &parser;
+        if (!read_pattern_body(client_socket, buffer, &params))
+            keep_alive = 0;
+    }
+    
+    printf("Executando OpenMP Game of Life: POWMIN=%d, POWMAX=%d, MODE=%s%s%s\n",
+           params.powmin, params.powmax, mode_name(params.mode),
+           params.pattern ? " (padrão)" : params.soup ? " (sopa)" : "", params.stream ? " (stream)" : "");
+    
+    if (params.stream) {
+        char headers[256];
+        int n = snprintf(headers, sizeof(headers),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/x-ndjson\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "Access-Control-Allow-Origin: *\r\n"
+            "Connection: %s\r\n"
+            "\r\n", keep_alive ? "keep-alive" : "close");
+        send_all(client_socket, headers, n);
+    }
+    
+    int success = run_with_cores(&params, &sink, &processing_time, &wait_time);
+    
+    char summary[512];
+    build_summary(summary, sizeof(summary), &params, success, processing_time, wait_time);
+    
+    if (params.stream) {
+        char line[640];
+        int n = snprintf(line, sizeof(line), "{\"done\":true,%s,\"total_time\":%.6f}\n",
+                         summary, sink.total_time);
+        send_chunk(client_socket, line, n);
+        send_chunk(client_socket, "", 0);
+    } else {
+        // Resposta HTTP JSON, dimensionada pelo texto acumulado
+        sink_append(&sink, "\\nTempo total: %.6f segundos", sink.total_time);
+        size_t size = sink.len + sizeof(summary) + 32;
+        char* body = malloc(size);
+        if (body) {
+            int n = snprintf(body, size, "{%s,\"details\":\"%s\"}",
+                             summary, sink.text ? sink.text : "");
+            send_json_response(client_socket, "200 OK", "", body, n, keep_alive);
+            free(body);
+        }
+    }
+    free(sink.text);
+    if (params.pattern)
+        pattern_parser_release(params.pattern);
+    
+    printf("Processamento concluído: %.6f segundos\n", processing_time);
+    return keep_alive;
+}
+
+// Executa um job de POST /jobs num worker; resultados, progresso e estado
+// ficam na tabela para GET /jobs/{id}. Um job cancelado ainda na fila nem
+// chega a pedir núcleos.
+void run_async_job(async_job_t* job) {
+    process_params_t params;
+    result_sink_t sink = { 0 };
+    double processing_time = 0.0, wait_time = 0.0;
+    char summary[512];
+    int success = 0, cancelled;
+    
+    pthread_mutex_lock(&jobs_mutex);
+    cancelled = atomic_load(&job->control.cancel);
+    if (!cancelled) {
+        job->state = JOB_RUNNING;
+        job->started = wall_time();
+    }
+    params = job->params;
+    pthread_mutex_unlock(&jobs_mutex);
+    
+    if (!cancelled) {
+        printf("Executando job %lld: POWMIN=%d, POWMAX=%d, MODE=%s\n",
+               job->id, params.powmin, params.powmax, mode_name(params.mode));
+        sink.job = job;
+        run_control = &job->control;
+        success = run_with_cores(&params, &sink, &processing_time, &wait_time);
+        run_control = NULL;
+        cancelled = atomic_load(&job->control.cancel);
+    }
+    build_summary(summary, sizeof(summary), &params, success && !cancelled,
+                  processing_time, wait_time);
+    
+    pthread_mutex_lock(&jobs_mutex);
+    job->state = cancelled ? JOB_CANCELLED : success ? JOB_DONE : JOB_FAILED;
+    job->finished = wall_time();
+    job->params.threads = params.threads;
+    snprintf(job->summary, sizeof(job->summary), "{\"done\":true,%s,\"cancelled\":%s,\"total_time\":%.6f}",
+             summary, cancelled ? "true" : "false", sink.total_time);
+    // Terminado, o slot pode ser despejado e reaproveitado assim que o
+    // mutex sai: o log usa o id copiado aqui
+    long long id = job->id;
+    pthread_mutex_unlock(&jobs_mutex);
+    
+    printf("Job %lld %s: %.6f segundos\n", id,
+           cancelled ? "cancelado" : "concluído", processing_time);
+}
+
+// Volta a acompanhar a conexão no laço de eventos, à espera da próxima
+// requisição; epoll_ctl pode ser chamado de qualquer thread
+void watch_connection(int fd) {
+    conn_t* conn = calloc(1, sizeof(conn_t));
+    if (!conn) {
+        close(fd);
+        return;
+    }
+    conn->fd = fd;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        close(fd);
+        free(conn);
+    }
+}
+
+void* worker_loop(void* arg) {
+    (void)arg;
+    while (1) {
+        job_t job;
         
-        printf("Executando OpenMP Game of Life: POWMIN=%d, POWMAX=%d\n", powmin, powmax);
-        
-        double start_time = wall_time();
-        int success = execute_game_of_life(powmin, powmax, result_buffer, sizeof(result_buffer));
-        double processing_time = wall_time() - start_time;
+        pthread_mutex_lock(&queue.mutex);
+        while (queue.count == 0)
+            pthread_cond_wait(&queue.not_empty, &queue.mutex);
+        job = queue.jobs[queue.head];
+        queue.head = (queue.head + 1) % queue.capacity;
+        queue.count--;
+        queue.busy++;
+        pthread_mutex_unlock(&queue.mutex);
         
-        // Resposta HTTP JSON
-        snprintf(response, sizeof(response),
-                "HTTP/1.1 200 OK\r\n"
-                "Content-Type: application/json\r\n"
-                "Access-Control-Allow-Origin: *\r\n"
-                "\r\n"
-                "{"
-                "\"success\":%s,"
-                "\"engine\":\"OpenMP\","
-                "\"powmin\":%d,"
-                "\"powmax\":%d,"
-                "\"processing_time\":%.6f,"
-                "\"threads\":%d,"
-                "\"details\":\"%s\""
-                "}",
-                success ? "true" : "false",
-                powmin, powmax, processing_time,
-                omp_get_max_threads(), result_buffer);
+        double queue_wait = wall_time() - job.enqueued_at;
+        metrics_observe(metrics.queue_wait, queue_wait);
+        if (job.async) {
+            printf("Worker: job assíncrono %lld (espera %.3fs)\n", job.async->id, queue_wait);
+            run_async_job(job.async);
+        } else {
+            printf("Worker: job da conexão %d (espera %.3fs)\n", job.socket, queue_wait);
+            if (handle_process(job.socket, job.request, job.keep_alive))
+                watch_connection(job.socket);
+            else
+                close(job.socket);
+            free(job.request);
+        }
         
-        printf("Processamento concluído: %.6f segundos\n", processing_time);
+        pthread_mutex_lock(&queue.mutex);
+        queue.busy--;
+        pthread_mutex_unlock(&queue.mutex);
+    }
+    return NULL;
+}
+
+// Coloca o job na fila; retorna 0 se a fila estiver cheia
+int enqueue_job(int socket, char* request, int keep_alive, async_job_t* async) {
+    pthread_mutex_lock(&queue.mutex);
+    if (queue.count == queue.capacity) {
+        queue.rejected++;
+        pthread_mutex_unlock(&queue.mutex);
+        return 0;
+    }
+    job_t* job = &queue.jobs[(queue.head + queue.count) % queue.capacity];
+    job->socket = socket;
+    job->request = request;
+    job->keep_alive = keep_alive;
+    job->async = async;
+    job->enqueued_at = wall_time();
+    queue.count++;
+    pthread_cond_signal(&queue.not_empty);
+    pthread_mutex_unlock(&queue.mutex);
+    return 1;
+}
+
+void close_connection(int epfd, conn_t* conn) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn);
+}
+
+const char* job_state_name(const async_job_t* job) {
+    switch (job->state) {
+        case JOB_QUEUED:
+        case JOB_RUNNING:
+            if (atomic_load(&job->control.cancel)) return "cancelling";
+            return job->state == JOB_QUEUED ? "queued" : "running";
+        case JOB_DONE:      return "done";
+        case JOB_FAILED:    return "failed";
+        default:            return "cancelled";
+    }
+}
+
+// Posição para um job novo: uma livre ou, com a tabela cheia, a do job
+// terminado há mais tempo. NULL se todos estiverem em andamento.
+// Chamado com jobs_mutex.
+async_job_t* job_slot_locked(void) {
+    async_job_t* slot = NULL;
+    int k;
+    for (k = 0; k < MAX_ASYNC_JOBS; k++) {
+        async_job_t* j = &async_jobs[k];
+        if (j->id == 0) return j;
+        if (j->state >= JOB_DONE && (!slot || j->finished < slot->finished))
+            slot = j;
+    }
+    return slot;
+}
+
+async_job_t* job_find_locked(long long id) {
+    int k;
+    for (k = 0; k < MAX_ASYNC_JOBS; k++)
+        if (id > 0 && async_jobs[k].id == id)
+            return &async_jobs[k];
+    return NULL;
+}
+
+// Primeiro id de job do pod: 62 bits de /dev/urandom (ou relógio e pid, se
+// não houver), sobrando espaço para os incrementos sem chegar ao sinal
+long long job_id_seed(void) {
+    unsigned long long seed = 0;
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0 || read(fd, &seed, sizeof(seed)) != (ssize_t)sizeof(seed))
+        seed = (unsigned long long)(wall_time() * 1e6) ^ ((unsigned long long)getpid() << 40);
+    if (fd >= 0) close(fd);
+    return (long long)(seed & ((1ULL << 62) - 1)) + 1;
+}
+
+// POST /jobs?powmin=X&powmax=Y[&...]: mesmos parâmetros de /process (o
+// corpo é ignorado); responde 202 com o id assim que o job entra na fila
+void handle_job_create(int fd, const char* request, int keep_alive) {
+    char body[256], location[64];
+    process_params_t params;
+    async_job_t* job;
     
-    } else if (strncmp(buffer, "GET /health", 11) == 0) {
-        // Health check
-        snprintf(response, sizeof(response),
-                "HTTP/1.1 200 OK\r\n"
-                "Content-Type: application/json\r\n"
-                "\r\n"
-                "{\"status\":\"healthy\",\"engine\":\"OpenMP\",\"threads\":%d}",
-                omp_get_max_threads());
+    if (!parse_request_params(request, &params)) {
+        build_bad_request_body(body, sizeof(body));
+        send_json_response(fd, "400 Bad Request", "", body, strlen(body), keep_alive);
+        return;
+    }
+    params.stream = 0;
     
-    } else {
-        // 404
-        snprintf(response, sizeof(response),
-                "HTTP/1.1 404 Not Found\r\n"
-                "Content-Type: application/json\r\n"
-                "\r\n"
-                "{\"error\":\"Not found\",\"endpoints\":[\"/process?powmin=X&powmax=Y\",\"/health\"]}");
+    pthread_mutex_lock(&jobs_mutex);
+    job = job_slot_locked();
+    if (job) {
+        free(job->results);
+        memset(job, 0, sizeof(*job));
+        job->id = next_job_id++;
+        job->state = JOB_QUEUED;
+        job->created = wall_time();
+        job->params = params;
     }
+    // Depois de enfileirado o job pode rodar e ser despejado da tabela a
+    // qualquer momento: o log e a resposta usam só o que foi copiado aqui
+    long long id = job ? job->id : 0;
+    int powmin = job ? job->params.powmin : 0, powmax = job ? job->params.powmax : 0;
+    const char* mode = job ? mode_name(job->params.mode) : "";
+    pthread_mutex_unlock(&jobs_mutex);
     
-    send(client_socket, response, strlen(response), 0);
-    close(client_socket);
+    if (!job || !enqueue_job(-1, NULL, 0, job)) {
+        if (job) {
+            pthread_mutex_lock(&jobs_mutex);
+            job->id = 0;
+            pthread_mutex_unlock(&jobs_mutex);
+        }
+        metrics_add(metrics.rejected, 1);
+        printf("Fila cheia: rejeitando job com 503\n");
+        snprintf(location, sizeof(location), "Retry-After: %d\r\n", RETRY_AFTER_SECONDS);
+        build_busy_body(body, sizeof(body));
+        send_json_response(fd, "503 Service Unavailable", location, body, strlen(body), keep_alive);
+        return;
+    }
+    
+    printf("Job %lld criado: POWMIN=%d, POWMAX=%d, MODE=%s\n", id, powmin, powmax, mode);
+    snprintf(location, sizeof(location), "Location: /jobs/%lld\r\n", id);
+    snprintf(body, sizeof(body), "{\"id\":%lld,\"status\":\"queued\",\"location\":\"/jobs/%lld\"}",
+             id, id);
+    send_json_response(fd, "202 Accepted", location, body, strlen(body), keep_alive);
+}
+
+// GET /jobs/{id}: estado, progresso do tam atual e resultados até aqui.
+// Cada resultado fica numa linha (o mesmo objeto de stream=ndjson), assim
+// como o resumo final, para que o socket server os repasse linha a linha.
+char* build_job_body(long long id, size_t* len) {
+    async_job_t* job;
+    result_sink_t out = { 0 };
+    
+    pthread_mutex_lock(&jobs_mutex);
+    job = job_find_locked(id);
+    if (job) {
+        double now = wall_time();
+        double elapsed = job->started == 0.0 ? 0.0 :
+                         (job->state == JOB_RUNNING ? now : job->finished) - job->started;
+        double queued = (job->started > 0.0 ? job->started :
+                         job->state == JOB_QUEUED ? now : job->finished) - job->created;
+        int tam = job->current_tam;
+        sink_append(&out,
+                "{\"id\":%lld,\"status\":\"%s\",\"powmin\":%d,\"powmax\":%d,\"mode\":\"%s\","
+                "\"current_tam\":%d,\"generation\":%ld,\"generations\":%d,"
+                "\"queued_time\":%.6f,\"elapsed\":%.6f,\"results\":[",
+                job->id, job_state_name(job), job->params.powmin, job->params.powmax,
+                mode_name(job->params.mode), tam, atomic_load(&job->control.generation),
+                tam > 3 ? 4*(tam-3) : 0, queued, elapsed);
+        // As linhas NDJSON viram elementos do array
+        const char* line = job->results;
+        int first = 1;
+        while (line && *line) {
+            const char* nl = strchr(line, '\n');
+            int n = nl ? nl - line : (int)strlen(line);
+            sink_append(&out, "%s\n%.*s", first ? "" : ",", n, line);
+            first = 0;
+            line = nl ? nl + 1 : line + n;
+        }
+        if (job->state >= JOB_DONE)
+            sink_append(&out, "\n],\"summary\":\n%s\n}", job->summary);
+        else
+            sink_append(&out, "\n],\"summary\":null}");
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+    *len = out.len;
+    return out.text;
+}
+
+// DELETE /jobs/{id}: pede o cancelamento; o worker para no próximo
+// ponto de verificação dos laços de gerações (ou o mpirun é encerrado)
+void handle_job_cancel(int fd, long long id, int keep_alive) {
+    char body[256];
+    async_job_t* job;
+    
+    pthread_mutex_lock(&jobs_mutex);
+    job = job_find_locked(id);
+    if (job) {
+        if (job->state < JOB_DONE) {
+            atomic_store(&job->control.cancel, 1);
+            if (job->mpi_pid > 0)
+                kill(job->mpi_pid, SIGTERM);
+            printf("Job %lld: cancelamento solicitado\n", id);
+        }
+        snprintf(body, sizeof(body), "{\"id\":%lld,\"status\":\"%s\"}", id, job_state_name(job));
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+    
+    if (!job)
+        snprintf(body, sizeof(body), "{\"error\":\"Job not found\"}");
+    send_json_response(fd, job ? "202 Accepted" : "404 Not Found", "", body, strlen(body), keep_alive);
+}
+
+// Resposta de /metrics em envio: dezenas de KB não cabem sempre no buffer
+// do socket, e um scraper lento não pode parar o laço de eventos
+typedef struct {
+    int fd, keep_alive;
+    char* text;
+    size_t len;
+} metrics_send_t;
+
+void* metrics_sender(void* arg) {
+    metrics_send_t* m = (metrics_send_t*)arg;
+    send_response(m->fd, "200 OK", "text/plain; version=0.0.4", "",
+                  m->text ? m->text : "", m->text ? m->len : 0, m->keep_alive);
+    if (m->keep_alive)
+        watch_connection(m->fd);
+    else
+        close(m->fd);
+    free(m->text);
+    free(m);
     return NULL;
 }
 
+// Lê o que estiver disponível; quando os cabeçalhos chegam completos,
+// responde direto (health, 404, 503) ou entrega /process à fila. Sem
+// pipelining: o cliente espera a resposta antes da próxima requisição.
+void handle_readable(int epfd, conn_t* conn) {
+    char body[1024];
+    
+    // Resto do corpo da requisição anterior: não é o início da próxima
+    while (conn->discard > 0) {
+        ssize_t n = recv(conn->fd, body, conn->discard < (long)sizeof(body) ? (size_t)conn->discard : sizeof(body), 0);
+        if (n > 0) {
+            conn->discard -= n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        close_connection(epfd, conn);
+        return;
+    }
+    
+    while (1) {
+        ssize_t n = recv(conn->fd, conn->buf + conn->len, BUFFER_SIZE - 1 - conn->len, 0);
+        if (n > 0) {
+            conn->len += n;
+            conn->buf[conn->len] = '\0';
+            if (strstr(conn->buf, "\r\n\r\n") || conn->len == BUFFER_SIZE - 1) break;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;   // aguarda mais dados
+        close_connection(epfd, conn);   // EOF ou erro antes do fim dos cabeçalhos
+        return;
+    }
+    
+    printf("Recebido: %s\n", conn->buf);
+    int keep_alive = wants_keep_alive(conn->buf);
+    
+    if (strncmp(conn->buf, "GET /process", 12) == 0 || strncmp(conn->buf, "POST /process", 13) == 0) {
+        metrics_add(metrics.req_process, 1);
+        char* request = strdup(conn->buf);
+        int fd = conn->fd;
+        
+        // O worker usa send bloqueante; a conexão sai do epoll
+        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        if (request && enqueue_job(fd, request, keep_alive, NULL)) {
+            free(conn);
+            return;
+        }
+        free(request);
+        metrics_add(metrics.rejected, 1);
+        printf("Fila cheia: rejeitando conexão %d com 503\n", fd);
+        char retry[64];
+        snprintf(retry, sizeof(retry), "Retry-After: %d\r\n", RETRY_AFTER_SECONDS);
+        build_busy_body(body, sizeof(body));
+        send_json_response(fd, "503 Service Unavailable", retry, body, strlen(body), 0);
+        close(fd);
+        free(conn);
+        return;
+    }
+    
+    long long job_id = 0;
+    if (strncmp(conn->buf, "POST /jobs", 10) == 0 && (conn->buf[10] == '?' || conn->buf[10] == ' ')) {
+        const char* length = header_value(conn->buf, "Content-Length");
+        const char* end = strstr(conn->buf, "\r\n\r\n");
+        metrics_add(metrics.req_jobs, 1);
+        handle_job_create(conn->fd, conn->buf, keep_alive);
+        // Os parâmetros vêm da query; um corpo, se houver, é descartado
+        if (length && end) {
+            long received = conn->len - (long)(end + 4 - conn->buf);
+            conn->discard = atol(length) > received ? atol(length) - received : 0;
+        }
+    } else if (sscanf(conn->buf, "GET /jobs/%lld", &job_id) == 1) {
+        size_t len;
+        metrics_add(metrics.req_jobs, 1);
+        char* text = build_job_body(job_id, &len);
+        if (!text)
+            snprintf(body, sizeof(body), "{\"error\":\"Job not found\"}");
+        send_json_response(conn->fd, text ? "200 OK" : "404 Not Found", "",
+                           text ? text : body, text ? len : strlen(body), keep_alive);
+        free(text);
+    } else if (sscanf(conn->buf, "DELETE /jobs/%lld", &job_id) == 1) {
+        metrics_add(metrics.req_jobs, 1);
+        handle_job_cancel(conn->fd, job_id, keep_alive);
+    } else if (strncmp(conn->buf, "GET /health", 11) == 0) {
+        metrics_add(metrics.req_health, 1);
+        build_health_body(body, sizeof(body));
+        send_json_response(conn->fd, "200 OK", "", body, strlen(body), keep_alive);
+    } else if (strncmp(conn->buf, "GET /metrics", 12) == 0) {
+        metrics_add(metrics.req_metrics, 1);
+        metrics_send_t* m = malloc(sizeof(metrics_send_t));
+        pthread_t thread;
+        if (m) {
+            m->fd = conn->fd;
+            m->keep_alive = keep_alive;
+            m->text = build_metrics_body(&m->len);
+            // A conexão sai do epoll enquanto a thread envia, como no /process
+            epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+            fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) & ~O_NONBLOCK);
+            if (pthread_create(&thread, NULL, metrics_sender, m) == 0) {
+                pthread_detach(thread);
+                free(conn);
+                return;
+            }
+            free(m->text);
+            free(m);
+        }
+        close_connection(epfd, conn);
+        return;
+    } else {
+        metrics_add(metrics.req_not_found, 1);
+        build_not_found_body(body, sizeof(body));
+        send_json_response(conn->fd, "404 Not Found", "", body, strlen(body), keep_alive);
+    }
+    
+    // Respostas pequenas cabem no buffer do socket
+    if (keep_alive)
+        conn->len = 0;
+    else
+        close_connection(epfd, conn);
+}
+
+int env_int(const char* name, int fallback) {
+    const char* v = getenv(name);
+    return v && atoi(v) > 0 ? atoi(v) : fallback;
+}
+
 int main() {
-    int server_socket, client_socket;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len = sizeof(client_addr);
+    int server_socket, epfd, i;
+    struct sockaddr_in server_addr;
     
     printf("OpenMP HTTP Engine iniciando na porta %d...\n", PORT);
     printf("Threads OpenMP disponíveis: %d\n", omp_get_max_threads());
     
+    select_vida_kernel();
+    printf("Kernel do Jogo da Vida: %s\n", vida_kernel->name);
+    vida_regras_init();
+    {
+        char regras[384];
+        vida_regras_list(regras, sizeof(regras));
+        printf("Regras com kernels especializados: %s\n", regras);
+    }
+    core_sched_init();
+    result_cache_init();
+    register_metrics();
+    next_job_id = job_id_seed();
+    printf("Núcleos gerenciados pelo escalonador: %d\n", core_sched_total());
+    
     server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket < 0) {
         perror("Erro ao criar socket");
@@ -241,24 +1609,67 @@ int main() {
         return 1;
     }
     
-    if (listen(server_socket, 10) < 0) {
+    if (listen(server_socket, SOMAXCONN) < 0) {
         perror("Erro no listen");
         return 1;
     }
+    fcntl(server_socket, F_SETFL, fcntl(server_socket, F_GETFL) | O_NONBLOCK);
+    
+    // Pool fixo de workers e fila limitada de jobs de /process
+    queue.workers = env_int("ENGINE_WORKERS", DEFAULT_WORKERS);
+    queue.capacity = env_int("ENGINE_QUEUE", DEFAULT_QUEUE_CAPACITY);
+    queue.jobs = calloc(queue.capacity, sizeof(job_t));
+    if (!queue.jobs) {
+        perror("Erro ao alocar fila");
+        return 1;
+    }
+    for (i = 0; i < queue.workers; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker_loop, NULL) != 0) {
+            perror("Erro ao criar worker");
+            return 1;
+        }
+        pthread_detach(thread);
+    }
+    
+    epfd = epoll_fd = epoll_create1(0);
+    if (epfd < 0) {
+        perror("Erro no epoll_create1");
+        return 1;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, server_socket, &ev);
     
     printf("OpenMP Engine aguardando requisições HTTP na porta %d...\n", PORT);
-    printf("Endpoints: /process?powmin=X&powmax=Y, /health\n");
+    printf("Workers: %d, capacidade da fila: %d\n", queue.workers, queue.capacity);
+    printf("Endpoints: /process?powmin=X&powmax=Y[&engine=int|packed|tiled|mpi|active|hashlife|cycle&rule=B3/S23&tile=T&tblock=K&np=N&cache=bypass&stream=ndjson], /process?soup=SEED[&checkpoint=NOME], /process?resume=NOME, POST /process (padrão RLE/plaintext), POST /jobs, GET|DELETE /jobs/{id}, /health, /metrics\n");
     
     while (1) {
-        client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &client_len);
-        if (client_socket < 0) continue;
-        
-        int* client_sock = malloc(sizeof(int));
-        *client_sock = client_socket;
+        struct epoll_event events[MAX_EVENTS];
+        int n = epoll_wait(epfd, events, MAX_EVENTS, -1);
         
-        pthread_t thread;
-        pthread_create(&thread, NULL, handle_client, client_sock);
-        pthread_detach(thread);
+        for (i = 0; i < n; i++) {
+            // data.ptr == NULL identifica o socket de escuta
+            if (events[i].data.ptr == NULL) {
+                int client_socket;
+                while ((client_socket = accept(server_socket, NULL, NULL)) >= 0) {
+                    conn_t* conn = calloc(1, sizeof(conn_t));
+                    if (!conn) {
+                        close(client_socket);
+                        continue;
+                    }
+                    conn->fd = client_socket;
+                    fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL) | O_NONBLOCK);
+                    // Cabeçalhos e corpo saem em sends separados; sem Nagle a
+                    // resposta não espera o ACK atrasado numa conexão keep-alive
+                    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+                    struct epoll_event cev = { .events = EPOLLIN, .data.ptr = conn };
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, client_socket, &cev);
+                }
+            } else {
+                handle_readable(epfd, (conn_t*)events[i].data.ptr);
+            }
+        }
     }
     
     close(server_socket);
@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <immintrin.h>
+#include <omp.h>
+#include "life_rules.h"
+#include "board_arena.h"
+
+// Máscaras: bit k = k vizinhos. O próximo estado de uma célula c (0/1) com
+// n vizinhos é o bit n + 9c da tabela (born | survive << 9); como a tabela
+// é constante em cada instância, o compilador a embute no código.
+#define V(k) (1u << (k))
+#define TABELA(B, S) ((B) | ((S) << 9))
+
+// Tabela de regras: apelido, rulestring canônica, nascimento, sobrevivência.
+// A B3/S23 não está aqui: usa os kernels originais de game_of_life.c.
+#define REGRAS(X) \
+    X(highlife,         "B36/S23",       V(3)|V(6),                V(2)|V(3)) \
+    X(daynight,         "B3678/S34678",  V(3)|V(6)|V(7)|V(8),      V(3)|V(4)|V(6)|V(7)|V(8)) \
+    X(seeds,            "B2/S",          V(2),                     0) \
+    X(lifewithoutdeath, "B3/S012345678", V(3),                     0x1ff) \
+    X(replicator,       "B1357/S1357",   V(1)|V(3)|V(5)|V(7),      V(1)|V(3)|V(5)|V(7)) \
+    X(morley,           "B368/S245",     V(3)|V(6)|V(8),           V(2)|V(4)|V(5)) \
+    X(diamoeba,         "B35678/S5678",  V(3)|V(5)|V(6)|V(7)|V(8), V(5)|V(6)|V(7)|V(8)) \
+    X(twobytwo,         "B36/S125",      V(3)|V(6),                V(1)|V(2)|V(5))
+
+// Uma linha, a partir da coluna j; também fecha o resto das versões vetoriais
+static inline __attribute__((always_inline))
+void linha_escalar(const int* up, const int* mid, const int* down, int* out,
+                   int j, int tam, unsigned tabela) {
+    for (; j <= tam; j++) {
+        int n = up[j-1] + up[j] + up[j+1] + mid[j-1] + mid[j+1] +
+                down[j-1] + down[j] + down[j+1];
+        out[j] = (tabela >> (n + 9*mid[j])) & 1;
+    }
+}
+
+// SSE4 não tem deslocamento variável por elemento: o índice n + 9c é
+// comparado com cada bit ligado da tabela (só os ligados geram código)
+#define SSE4_BIT(k) \
+    if (tabela & V(k)) v = _mm_or_si128(v, _mm_cmpeq_epi32(idx, _mm_set1_epi32(k)))
+
+static inline __attribute__((target("sse4.2"), always_inline))
+void linha_sse4(const int* up, const int* mid, const int* down, int* out,
+                int tam, unsigned tabela) {
+    const __m128i um = _mm_set1_epi32(1);
+    int j;
+    for (j=1; j+3<=tam; j+=4) {
+        __m128i n = _mm_add_epi32(
+            _mm_add_epi32(
+                _mm_add_epi32(_mm_loadu_si128((const __m128i*)(up+j-1)),
+                              _mm_loadu_si128((const __m128i*)(up+j))),
+                _mm_add_epi32(_mm_loadu_si128((const __m128i*)(up+j+1)),
+                              _mm_loadu_si128((const __m128i*)(mid+j-1)))),
+            _mm_add_epi32(
+                _mm_add_epi32(_mm_loadu_si128((const __m128i*)(mid+j+1)),
+                              _mm_loadu_si128((const __m128i*)(down+j-1))),
+                _mm_add_epi32(_mm_loadu_si128((const __m128i*)(down+j)),
+                              _mm_loadu_si128((const __m128i*)(down+j+1)))));
+        __m128i c = _mm_loadu_si128((const __m128i*)(mid+j));
+        __m128i idx = _mm_add_epi32(n, _mm_add_epi32(_mm_slli_epi32(c, 3), c));
+        __m128i v = _mm_setzero_si128();
+        SSE4_BIT(0);  SSE4_BIT(1);  SSE4_BIT(2);  SSE4_BIT(3);  SSE4_BIT(4);  SSE4_BIT(5);
+        SSE4_BIT(6);  SSE4_BIT(7);  SSE4_BIT(8);  SSE4_BIT(9);  SSE4_BIT(10); SSE4_BIT(11);
+        SSE4_BIT(12); SSE4_BIT(13); SSE4_BIT(14); SSE4_BIT(15); SSE4_BIT(16); SSE4_BIT(17);
+        _mm_storeu_si128((__m128i*)(out+j), _mm_and_si128(v, um));
+    }
+    linha_escalar(up, mid, down, out, j, tam, tabela);
+}
+
+// AVX2 e AVX-512: a tabela inteira num registrador, deslocada por elemento
+static inline __attribute__((target("avx2"), always_inline))
+void linha_avx2(const int* up, const int* mid, const int* down, int* out,
+                int tam, unsigned tabela) {
+    const __m256i um = _mm256_set1_epi32(1), t = _mm256_set1_epi32(tabela);
+    int j;
+    for (j=1; j+7<=tam; j+=8) {
+        __m256i n = _mm256_add_epi32(
+            _mm256_add_epi32(
+                _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(up+j-1)),
+                                 _mm256_loadu_si256((const __m256i*)(up+j))),
+                _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(up+j+1)),
+                                 _mm256_loadu_si256((const __m256i*)(mid+j-1)))),
+            _mm256_add_epi32(
+                _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(mid+j+1)),
+                                 _mm256_loadu_si256((const __m256i*)(down+j-1))),
+                _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(down+j)),
+                                 _mm256_loadu_si256((const __m256i*)(down+j+1)))));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(mid+j));
+        __m256i idx = _mm256_add_epi32(n, _mm256_add_epi32(_mm256_slli_epi32(c, 3), c));
+        _mm256_storeu_si256((__m256i*)(out+j), _mm256_and_si256(_mm256_srlv_epi32(t, idx), um));
+    }
+    linha_escalar(up, mid, down, out, j, tam, tabela);
+}
+
+static inline __attribute__((target("avx512f"), always_inline))
+void linha_avx512(const int* up, const int* mid, const int* down, int* out,
+                  int tam, unsigned tabela) {
+    const __m512i um = _mm512_set1_epi32(1), t = _mm512_set1_epi32(tabela);
+    int j;
+    for (j=1; j+15<=tam; j+=16) {
+        __m512i n = _mm512_add_epi32(
+            _mm512_add_epi32(
+                _mm512_add_epi32(_mm512_loadu_si512(up+j-1), _mm512_loadu_si512(up+j)),
+                _mm512_add_epi32(_mm512_loadu_si512(up+j+1), _mm512_loadu_si512(mid+j-1))),
+            _mm512_add_epi32(
+                _mm512_add_epi32(_mm512_loadu_si512(mid+j+1), _mm512_loadu_si512(down+j-1)),
+                _mm512_add_epi32(_mm512_loadu_si512(down+j), _mm512_loadu_si512(down+j+1))));
+        __m512i c = _mm512_loadu_si512(mid+j);
+        __m512i idx = _mm512_add_epi32(n, _mm512_add_epi32(_mm512_slli_epi32(c, 3), c));
+        _mm512_storeu_si512(out+j, _mm512_and_si512(_mm512_srlv_epi32(t, idx), um));
+    }
+    linha_escalar(up, mid, down, out, j, tam, tabela);
+}
+
+// Os quatro kernels de uma regra, com a tabela como constante literal
+#define LINHAS(linha, tabela) do { \
+    int i; \
+    _Pragma("omp parallel for") \
+    for (i=ilo; i<=ihi; i++) \
+        linha(tabulIn + ind2d(i-1,0), tabulIn + ind2d(i,0), tabulIn + ind2d(i+1,0), \
+              tabulOut + ind2d(i,0), 1, tam, tabela); \
+} while (0)
+
+#define LINHAS_SIMD(linha, tabela) do { \
+    int i; \
+    _Pragma("omp parallel for") \
+    for (i=ilo; i<=ihi; i++) \
+        linha(tabulIn + ind2d(i-1,0), tabulIn + ind2d(i,0), tabulIn + ind2d(i+1,0), \
+              tabulOut + ind2d(i,0), tam, tabela); \
+} while (0)
+
+#define INSTANCIAR(id, nome, B, S) \
+static void UmaVidaEscalar_##id(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) { \
+    LINHAS(linha_escalar, TABELA(B, S)); \
+} \
+__attribute__((target("sse4.2"))) \
+static void UmaVidaSSE4_##id(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) { \
+    LINHAS_SIMD(linha_sse4, TABELA(B, S)); \
+} \
+__attribute__((target("avx2"))) \
+static void UmaVidaAVX2_##id(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) { \
+    LINHAS_SIMD(linha_avx2, TABELA(B, S)); \
+} \
+__attribute__((target("avx512f"))) \
+static void UmaVidaAVX512_##id(int* tabulIn, int* tabulOut, int tam, int ilo, int ihi) { \
+    LINHAS_SIMD(linha_avx512, TABELA(B, S)); \
+}
+
+REGRAS(INSTANCIAR)
+
+#define ENTRADA(id, nome, B, S) \
+    { nome, #id, B, S, { UmaVidaEscalar_##id, UmaVidaSSE4_##id, UmaVidaAVX2_##id, UmaVidaAVX512_##id }, 0 },
+
+vida_regra_t vida_regras[] = {
+    { "B3/S23", "conway", V(3), V(2)|V(3), { UmaVidaFaixa, UmaVidaSSE4, UmaVidaAVX2, UmaVidaAVX512 }, 1 },
+    REGRAS(ENTRADA)
+};
+const int num_vida_regras = sizeof(vida_regras)/sizeof(vida_regras[0]);
+
+// Roda o glider num tabuleiro pequeno com o kernel escalar da regra
+static int glider_chega(const vida_regra_t* regra, int tam) {
+    int g, ok = 0;
+    int* a = calloc((size_t)(tam+2)*(tam+2), sizeof(int));
+    int* b = calloc((size_t)(tam+2)*(tam+2), sizeof(int));
+    if (a && b) {
+        InitGlider(a, tam);
+        for (g = 0; g < 2*(tam-3); g++) {
+            regra->fn[0](a, b, tam, 1, tam);
+            regra->fn[0](b, a, tam, 1, tam);
+        }
+        ok = Correto(a, tam);
+    }
+    free(a);
+    free(b);
+    return ok;
+}
+
+void vida_regras_init(void) {
+    int k;
+    for (k = 1; k < num_vida_regras; k++)
+        vida_regras[k].glider = glider_chega(&vida_regras[k], 16) &&
+                                glider_chega(&vida_regras[k], 32);
+}
+
+// Dígitos 0-8 em máscara; -1 se aparecer outra coisa
+static int mascara(const char* s, size_t len) {
+    int m = 0;
+    size_t k;
+    for (k = 0; k < len; k++) {
+        if (s[k] < '0' || s[k] > '8') return -1;
+        m |= V(s[k] - '0');
+    }
+    return m;
+}
+
+const vida_regra_t* vida_regra_parse(const char* rulestring) {
+    char buf[VIDA_REGRA_LEN];
+    const char *barra, *b, *s;
+    size_t n = 0, lb, ls;
+    int born, survive, k;
+
+    // Minúsculas, com %2F da query decodificado
+    for (; *rulestring && n + 1 < sizeof(buf); rulestring++) {
+        if (strncasecmp(rulestring, "%2f", 3) == 0) {
+            buf[n++] = '/';
+            rulestring += 2;
+        } else {
+            buf[n++] = tolower((unsigned char)*rulestring);
+        }
+    }
+    buf[n] = '\0';
+
+    for (k = 0; k < num_vida_regras; k++)
+        if (strcmp(buf, vida_regras[k].alias) == 0)
+            return &vida_regras[k];
+
+    barra = strchr(buf, '/');
+    if (!barra) return NULL;
+    if (buf[0] == 'b' || buf[0] == 's') {
+        // B.../S... em qualquer ordem
+        const char* outra = barra + 1;
+        if (*outra != 'b' && *outra != 's') return NULL;
+        if (buf[0] == *outra) return NULL;
+        b = buf[0] == 'b' ? buf + 1 : outra + 1;
+        lb = buf[0] == 'b' ? (size_t)(barra - buf - 1) : strlen(outra + 1);
+        s = buf[0] == 's' ? buf + 1 : outra + 1;
+        ls = buf[0] == 's' ? (size_t)(barra - buf - 1) : strlen(outra + 1);
+    } else {
+        // Notação S/B: sobrevivência antes da barra
+        s = buf;
+        ls = barra - buf;
+        b = barra + 1;
+        lb = strlen(b);
+    }
+    born = mascara(b, lb);
+    survive = mascara(s, ls);
+    if (born < 0 || survive < 0) return NULL;
+
+    for (k = 0; k < num_vida_regras; k++)
+        if (vida_regras[k].born == (unsigned)born && vida_regras[k].survive == (unsigned)survive)
+            return &vida_regras[k];
+    return NULL;
+}
+
+void vida_regras_list(char* out, size_t size) {
+    size_t n = 0;
+    int k;
+    out[0] = '\0';
+    for (k = 0; k < num_vida_regras && n < size; k++)
+        n += snprintf(out + n, size - n, "%s%s (%s)", k ? ", " : "",
+                      vida_regras[k].name, vida_regras[k].alias);
+}
+
+uma_vida_fn vida_regra_kernel(const vida_regra_t* regra) {
+    return regra->fn[vida_kernel - vida_kernels];
+}
+
+// Executar um tamanho com tabuleiro de int e a regra dada
+int run_size_rule(int tam, const vida_regra_t* regra, size_result_t* r) {
+    int i, *tabulIn, *tabulOut;
+    uma_vida_fn fn = vida_regra_kernel(regra);
+    double t0, t1, t2, t3;
+
+    t0 = wall_time();
+    tabulIn = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    tabulOut = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    if (!tabulIn || !tabulOut) {
+        board_release(tabulIn);
+        board_release(tabulOut);
+        return 0;
+    }
+
+    InitGlider(tabulIn, tam);
+    t1 = wall_time();
+
+    for (i = 0; i < 2*(tam-3); i++) {
+        fn(tabulIn, tabulOut, tam, 1, tam);
+        fn(tabulOut, tabulIn, tam, 1, tam);
+        if (run_checkpoint(2L*(i+1))) break;
+    }
+    t2 = wall_time();
+
+    r->correct = regra->glider ? Correto(tabulIn, tam) : -1;
+    t3 = wall_time();
+
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    board_release(tabulIn);
+    board_release(tabulOut);
+    return 1;
+}
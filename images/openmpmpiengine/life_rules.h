@@ -0,0 +1,43 @@
+#ifndef LIFE_RULES_H
+#define LIFE_RULES_H
+
+#include "game_of_life.h"
+
+// Regras totalísticas B/S (ex.: B36/S23 = nasce com 3 ou 6 vizinhos,
+// sobrevive com 2 ou 3). Não há interpretação da regra no laço interno:
+// cada regra da tabela tem os kernels do tabuleiro de int instanciados em
+// tempo de compilação com as máscaras como constantes, e uma regra nova
+// custa uma linha em life_rules.c. A B3/S23 usa os kernels originais.
+
+#define VIDA_REGRA_LEN 32
+
+typedef struct {
+    const char* name;           // rulestring canônica, ex. "B36/S23"
+    const char* alias;          // nome usual aceito em rule=, ex. "highlife"
+    unsigned born, survive;     // bit k: nasce/sobrevive com k vizinhos
+    uma_vida_fn fn[4];          // um kernel por entrada de vida_kernels, na mesma ordem
+    int glider;                 // 1 se o glider de InitGlider chega ao canto como na B3/S23
+} vida_regra_t;
+
+extern vida_regra_t vida_regras[];
+extern const int num_vida_regras;
+#define VIDA_REGRA_CONWAY (&vida_regras[0])
+
+// Calcula o campo glider de cada regra simulando um tabuleiro pequeno
+void vida_regras_init(void);
+
+// Aceita "B36/S23", "b36/s23", "S23/B36", a notação S/B "23/36", "%2F"
+// no lugar da barra e os apelidos; NULL se a regra não tem kernels
+const vida_regra_t* vida_regra_parse(const char* rulestring);
+
+// Lista "B3/S23 (conway), ..." para mensagens de erro e do início
+void vida_regras_list(char* out, size_t size);
+
+// Kernel da regra com a mesma largura de vetor de vida_kernel
+uma_vida_fn vida_regra_kernel(const vida_regra_t* regra);
+
+// run_size_int com a regra dada. Correto só se aplica quando o glider da
+// regra se comporta como na B3/S23; nas demais r->correct fica -1.
+int run_size_rule(int tam, const vida_regra_t* regra, size_result_t* r);
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include "metrics.h"
+
+typedef enum { METRIC_COUNTER, METRIC_HISTOGRAM } metric_kind_t;
+
+// Um shard por linha de cache, para que threads diferentes não disputem
+typedef struct {
+    _Atomic double sum;
+    atomic_ulong bucket[METRICS_BUCKETS + 1];   // o último é o +Inf
+} __attribute__((aligned(64))) metric_shard_t;
+
+struct metric {
+    metric_kind_t kind;
+    const char* name;
+    const char* labels;
+    const char* help;
+    double min;
+    metric_shard_t shard[METRICS_SHARDS];
+};
+
+static metric_t* registradas[METRICS_MAX];
+static int nregistradas = 0;
+static atomic_int proximo_shard = 0;
+static __thread int meu_shard = -1;
+
+static metric_t* registrar(metric_kind_t kind, const char* name, const char* labels,
+                           const char* help, double min) {
+    metric_t* m;
+    if (nregistradas == METRICS_MAX) {
+        fprintf(stderr, "Limite de métricas atingido ao registrar %s\n", name);
+        return NULL;
+    }
+    m = aligned_alloc(64, sizeof(metric_t));
+    if (!m) return NULL;
+    memset(m, 0, sizeof(metric_t));
+    m->kind = kind;
+    m->name = name;
+    m->labels = labels;
+    m->help = help;
+    m->min = min;
+    registradas[nregistradas++] = m;
+    return m;
+}
+
+metric_t* metrics_counter(const char* name, const char* labels, const char* help) {
+    return registrar(METRIC_COUNTER, name, labels, help, 0.0);
+}
+
+metric_t* metrics_histogram(const char* name, const char* labels, const char* help, double min) {
+    return registrar(METRIC_HISTOGRAM, name, labels, help, min);
+}
+
+static metric_shard_t* shard_da_thread(metric_t* m) {
+    if (meu_shard < 0)
+        meu_shard = atomic_fetch_add_explicit(&proximo_shard, 1, memory_order_relaxed) % METRICS_SHARDS;
+    return &m->shard[meu_shard];
+}
+
+// Soma em double via CAS; sem disputa quando cada thread tem seu shard
+static void somar(_Atomic double* alvo, double v) {
+    double atual = atomic_load_explicit(alvo, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(alvo, &atual, atual + v,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+void metrics_add(metric_t* counter, double value) {
+    if (!counter) return;
+    somar(&shard_da_thread(counter)->sum, value);
+}
+
+void metrics_observe(metric_t* histogram, double value) {
+    metric_shard_t* s;
+    double limite;
+    int k = 0;
+
+    if (!histogram) return;
+    s = shard_da_thread(histogram);
+    for (limite = histogram->min; k < METRICS_BUCKETS && value > limite; k++)
+        limite *= 2.0;
+    atomic_fetch_add_explicit(&s->bucket[k], 1, memory_order_relaxed);
+    somar(&s->sum, value);
+}
+
+void metrics_appendf(char** text, size_t* len, size_t* cap, const char* fmt, ...) {
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (*len + n + 1 > *cap) {
+        size_t novo = *cap ? *cap : 4096;
+        while (novo < *len + n + 1) novo *= 2;
+        char* t = realloc(*text, novo);
+        if (!t) return;
+        *text = t;
+        *cap = novo;
+    }
+    va_start(ap, fmt);
+    vsnprintf(*text + *len, *cap - *len, fmt, ap);
+    va_end(ap);
+    *len += n;
+}
+
+// Rótulos de um balde: os da métrica mais le="..."
+static void rotulos_balde(char* buf, size_t size, const char* labels, const char* le) {
+    snprintf(buf, size, "{%s%sle=\"%s\"}", labels ? labels : "", labels ? "," : "", le);
+}
+
+char* metrics_render(size_t* len, size_t* cap) {
+    char* text = NULL;
+    int i, k, sh;
+
+    *len = 0;
+    *cap = 0;
+    metrics_appendf(&text, len, cap, "%s", "");
+    for (i = 0; i < nregistradas; i++) {
+        metric_t* m = registradas[i];
+        const char* tipo = m->kind == METRIC_COUNTER ? "counter" : "histogram";
+        char lb[256];
+
+        if (i == 0 || strcmp(registradas[i-1]->name, m->name) != 0)
+            metrics_appendf(&text, len, cap, "# HELP %s %s\n# TYPE %s %s\n",
+                            m->name, m->help, m->name, tipo);
+
+        double sum = 0.0;
+        unsigned long acumulado = 0;
+        for (sh = 0; sh < METRICS_SHARDS; sh++)
+            sum += atomic_load_explicit(&m->shard[sh].sum, memory_order_relaxed);
+        if (m->labels)
+            snprintf(lb, sizeof(lb), "{%s}", m->labels);
+        else
+            lb[0] = '\0';
+
+        if (m->kind == METRIC_COUNTER) {
+            metrics_appendf(&text, len, cap, "%s%s %.17g\n", m->name, lb, sum);
+            continue;
+        }
+
+        double limite = m->min;
+        for (k = 0; k <= METRICS_BUCKETS; k++) {
+            char le[32], blb[300];
+            for (sh = 0; sh < METRICS_SHARDS; sh++)
+                acumulado += atomic_load_explicit(&m->shard[sh].bucket[k], memory_order_relaxed);
+            if (k < METRICS_BUCKETS)
+                snprintf(le, sizeof(le), "%.6g", limite);
+            else
+                snprintf(le, sizeof(le), "+Inf");
+            rotulos_balde(blb, sizeof(blb), m->labels, le);
+            metrics_appendf(&text, len, cap, "%s_bucket%s %lu\n", m->name, blb, acumulado);
+            limite *= 2.0;
+        }
+        // _count é o balde +Inf, para ficar coerente mesmo com escritas concorrentes
+        metrics_appendf(&text, len, cap, "%s_sum%s %.17g\n%s_count%s %lu\n",
+                        m->name, lb, sum, m->name, lb, acumulado);
+    }
+    return text;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+#include "game_of_life.h"
+
+// Engine híbrido MPI+OpenMP: o tabuleiro é dividido em faixas de linhas
+// entre os ranks, e cada geração troca as linhas fantasma com os vizinhos
+// enquanto o interior da faixa é calculado pelas threads OpenMP.
+//
+// Uso: mpirun -np N ./mpi_engine POWMIN POWMAX
+// O rank 0 imprime uma linha por tamanho no mesmo formato do engine HTTP.
+
+#define TAG_PARA_CIMA 1
+#define TAG_PARA_BAIXO 2
+
+// Faixa local: linhas 1..nloc do rank, mais as fantasmas 0 e nloc+1
+typedef struct {
+    int tam, nloc, offset;   // offset = linha global da linha local 1
+    int up, down;            // ranks vizinhos (MPI_PROC_NULL nas bordas)
+    int *tabulIn, *tabulOut;
+} faixa_t;
+
+// Linhas globais 1..tam repartidas o mais igualmente possível
+void dividir_linhas(int tam, int rank, int nprocs, int* nloc, int* offset) {
+    int base = tam / nprocs, resto = tam % nprocs;
+    *nloc = base + (rank < resto ? 1 : 0);
+    *offset = 1 + rank*base + (rank < resto ? rank : resto);
+}
+
+void init_faixa(faixa_t* f) {
+    int tam = f->tam;
+    int i;
+
+    #pragma omp parallel for
+    for (i = 0; i < f->nloc+2; i++) {
+        memset(f->tabulIn + ind2d(i,0), 0, (tam+2)*sizeof(int));
+        memset(f->tabulOut + ind2d(i,0), 0, (tam+2)*sizeof(int));
+    }
+
+    // Mesmo glider de InitTabul, nas linhas globais 1..3
+    int gl[5][2] = { {1,2}, {2,3}, {3,1}, {3,2}, {3,3} };
+    for (i = 0; i < 5; i++) {
+        int li = gl[i][0] - f->offset + 1;
+        if (li >= 1 && li <= f->nloc)
+            f->tabulIn[ind2d(li, gl[i][1])] = 1;
+    }
+}
+
+// Uma geração: envia as linhas de borda, calcula o interior enquanto as
+// mensagens trafegam e só então calcula as duas linhas de borda.
+void uma_vida_faixa(faixa_t* f) {
+    int tam = f->tam, nloc = f->nloc;
+    int* in = f->tabulIn;
+    MPI_Request req[4];
+
+    MPI_Irecv(in + ind2d(0,0), tam+2, MPI_INT, f->up, TAG_PARA_BAIXO, MPI_COMM_WORLD, &req[0]);
+    MPI_Irecv(in + ind2d(nloc+1,0), tam+2, MPI_INT, f->down, TAG_PARA_CIMA, MPI_COMM_WORLD, &req[1]);
+    MPI_Isend(in + ind2d(1,0), tam+2, MPI_INT, f->up, TAG_PARA_CIMA, MPI_COMM_WORLD, &req[2]);
+    MPI_Isend(in + ind2d(nloc,0), tam+2, MPI_INT, f->down, TAG_PARA_BAIXO, MPI_COMM_WORLD, &req[3]);
+
+    if (nloc > 2)
+        vida_kernel->fn(in, f->tabulOut, tam, 2, nloc-1);
+
+    MPI_Waitall(4, req, MPI_STATUSES_IGNORE);
+
+    vida_kernel->fn(in, f->tabulOut, tam, 1, 1);
+    if (nloc > 1)
+        vida_kernel->fn(in, f->tabulOut, tam, nloc, nloc);
+
+    f->tabulIn = f->tabulOut;
+    f->tabulOut = in;
+}
+
+// Correto distribuído: população total e as 5 células esperadas do glider
+int correto_faixa(const faixa_t* f) {
+    int tam = f->tam;
+    long pop = 0, local[2], global[2];
+    int esperadas[5][2] = { {tam-2,tam-1}, {tam-1,tam}, {tam,tam-2}, {tam,tam-1}, {tam,tam} };
+    int i, j;
+
+    #pragma omp parallel for private(j) reduction(+:pop)
+    for (i = 1; i <= f->nloc; i++)
+        for (j = 1; j <= tam; j++)
+            pop += f->tabulIn[ind2d(i,j)];
+
+    local[0] = pop;
+    local[1] = 0;
+
+    for (i = 0; i < 5; i++) {
+        int li = esperadas[i][0] - f->offset + 1;
+        if (li >= 1 && li <= f->nloc)
+            local[1] += f->tabulIn[ind2d(li, esperadas[i][1])];
+    }
+
+    MPI_Allreduce(local, global, 2, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    return global[0] == 5 && global[1] == 5;
+}
+
+int main(int argc, char** argv) {
+    int provided, rank, nprocs, powmin, powmax, pow, i;
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    if (argc < 3) {
+        if (rank == 0)
+            fprintf(stderr, "Uso: mpirun -np N %s POWMIN POWMAX\n", argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+    powmin = atoi(argv[1]);
+    powmax = atoi(argv[2]);
+
+    select_vida_kernel();
+    if (rank == 0)
+        printf("MPI Engine Results (Ranks: %d, Threads/rank: %d, Kernel: %s):\n",
+               nprocs, omp_get_max_threads(), vida_kernel->name);
+
+    int status = 0;
+    for (pow = powmin; pow <= powmax; pow++) {
+        faixa_t f;
+        double t0, t1, t2, t3;
+        int ok, ok_global;
+
+        f.tam = 1 << pow;
+        int tam = f.tam;
+        if (nprocs > tam) {
+            if (rank == 0)
+                printf("ERRO: %d ranks para tam=%d (máximo 1 rank por linha)\n", nprocs, tam);
+            status = 1;
+            break;
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        dividir_linhas(tam, rank, nprocs, &f.nloc, &f.offset);
+        f.up = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+        f.down = rank < nprocs - 1 ? rank + 1 : MPI_PROC_NULL;
+        f.tabulIn = (int*)malloc((size_t)(f.nloc+2)*(tam+2)*sizeof(int));
+        f.tabulOut = (int*)malloc((size_t)(f.nloc+2)*(tam+2)*sizeof(int));
+        ok = f.tabulIn && f.tabulOut;
+        MPI_Allreduce(&ok, &ok_global, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        if (!ok_global) {
+            if (rank == 0)
+                printf("ERRO: Falha na alocação para tam=%d\n", tam);
+            free(f.tabulIn);
+            free(f.tabulOut);
+            status = 1;
+            break;
+        }
+
+        init_faixa(&f);
+        MPI_Barrier(MPI_COMM_WORLD);
+        t1 = MPI_Wtime();
+
+        for (i = 0; i < 2*(tam-3); i++) {
+            uma_vida_faixa(&f);
+            uma_vida_faixa(&f);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        t2 = MPI_Wtime();
+
+        int is_correct = correto_faixa(&f);
+        t3 = MPI_Wtime();
+
+        if (rank == 0) {
+            printf("tam=%d: %s - init=%.7f, comp=%.7f, check=%.7f, total=%.7f\n",
+                   tam, is_correct ? "CORRETO" : "ERRADO",
+                   t1-t0, t2-t1, t3-t2, t3-t0);
+            fflush(stdout);
+        }
+        if (!is_correct) status = 1;
+
+        free(f.tabulIn);
+        free(f.tabulOut);
+    }
+
+    MPI_Finalize();
+    return status;
+}
@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <omp.h>
+#include "pattern.h"
+#include "board_arena.h"
+
+static inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Índice da célula no tabuleiro de int, em 64 bits: a sopa e o hash o
+// usam também no packed, cujo lado passa de 46340 fora do núcleo
+static inline uint64_t celula(int i, int j, int tam) {
+    return (uint64_t)i*(tam+2) + j;
+}
+
+void pattern_parser_init(pattern_parser_t* p, pattern_format_t format, int tam, int x, int y) {
+    memset(p, 0, sizeof(*p));
+    p->format = format;
+    p->req_tam = tam;
+    p->req_x = x;
+    p->req_y = y;
+    p->line_start = 1;
+}
+
+void pattern_parser_release(pattern_parser_t* p) {
+    board_release(p->tabul);
+    p->tabul = NULL;
+}
+
+// Aloca o tabuleiro quando a geometria fica conhecida: no cabeçalho RLE
+// (w, h > 0) ou na primeira célula de um padrão sem cabeçalho
+static int alocar(pattern_parser_t* p, long w, long h) {
+    long tam = p->req_tam;
+    if (tam <= 0) {
+        long lado = w > h ? w : h;
+        if (lado > 0) {
+            for (tam = PATTERN_MIN_TAM; tam < 2*lado && tam < PATTERN_MAX_TAM; tam *= 2)
+                ;
+        } else {
+            tam = PATTERN_DEFAULT_TAM;
+        }
+    }
+    if (tam < 4 || tam > PATTERN_MAX_TAM) {
+        snprintf(p->error, sizeof(p->error), "tam=%ld fora de 4-%d", tam, PATTERN_MAX_TAM);
+        return -1;
+    }
+    p->tabul = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    if (!p->tabul) {
+        snprintf(p->error, sizeof(p->error), "Falha na alocação para tam=%ld", tam);
+        return -1;
+    }
+    p->tam = (int)tam;
+    p->x0 = p->req_x >= 0 ? p->req_x : w > 0 ? 1 + (tam - w)/2 : 1;
+    p->y0 = p->req_y >= 0 ? p->req_y : h > 0 ? 1 + (tam - h)/2 : 1;
+    return 0;
+}
+
+// Liga n células a partir de (row, col) do padrão, recortando na borda
+static int celulas(pattern_parser_t* p, long n) {
+    int tam;
+    long i, j0, j1, j;
+    if (!p->tabul && alocar(p, 0, 0) < 0) return -1;
+    tam = p->tam;
+    i = p->y0 + p->row;
+    j0 = p->x0 + p->col;
+    j1 = j0 + n - 1;
+    p->col += n;
+    if (i < 1 || i > tam || j1 < 1 || j0 > tam) {
+        p->clipped += n;
+        return 0;
+    }
+    if (j0 < 1) { p->clipped += 1 - j0; j0 = 1; }
+    if (j1 > tam) { p->clipped += j1 - tam; j1 = tam; }
+    for (j = j0; j <= j1; j++) {
+        p->alive += !p->tabul[ind2d(i,j)];
+        p->tabul[ind2d(i,j)] = 1;
+    }
+    return 0;
+}
+
+// "x = 36, y = 9, rule = B3/S23"
+static int cabecalho(pattern_parser_t* p) {
+    long w = 0, h = 0;
+    char* campo = strtok(p->header, ",");
+    while (campo) {
+        char* igual = strchr(campo, '=');
+        char *chave = campo, *valor;
+        if (igual) {
+            *igual = '\0';
+            valor = igual + 1;
+            while (isspace((unsigned char)*chave)) chave++;
+            while (isspace((unsigned char)*valor)) valor++;
+            if (strncmp(chave, "x", 1) == 0 && (isspace((unsigned char)chave[1]) || !chave[1]))
+                w = atol(valor);
+            else if (strncmp(chave, "y", 1) == 0 && (isspace((unsigned char)chave[1]) || !chave[1]))
+                h = atol(valor);
+            else if (strncmp(chave, "rule", 4) == 0)
+                snprintf(p->rule, sizeof(p->rule), "%.*s", (int)strcspn(valor, " \t:"), valor);
+        }
+        campo = strtok(NULL, ",");
+    }
+    if (w < 0 || h < 0) {
+        snprintf(p->error, sizeof(p->error), "Cabeçalho RLE inválido");
+        return -1;
+    }
+    return p->tabul ? 0 : alocar(p, w, h);
+}
+
+static int rle(pattern_parser_t* p, char c) {
+    long n = p->count > 0 ? p->count : 1;
+    if (c >= '0' && c <= '9') {
+        if (p->count < (1L << 30)) p->count = p->count*10 + (c - '0');
+        return 0;
+    }
+    if (isspace((unsigned char)c)) return 0;
+    p->count = 0;
+    if (c == 'b' || c == '.') {
+        p->col += n;
+    } else if (c == '$') {
+        p->row += n;
+        p->col = 0;
+    } else if (c == '!') {
+        p->done = 1;
+    } else if (isalpha((unsigned char)c)) {
+        // o, ou qualquer outro estado vivo de arquivos multiestado
+        return celulas(p, n);
+    } else {
+        snprintf(p->error, sizeof(p->error), "Caractere inválido no RLE: '%c'", c);
+        return -1;
+    }
+    return 0;
+}
+
+static int plaintext(pattern_parser_t* p, char c) {
+    if (c == '\n') {
+        p->row++;
+        p->col = 0;
+        p->line_start = 1;
+    } else if (c == '.') {
+        p->col++;
+    } else if (c == 'O' || c == 'o' || c == '*') {
+        return celulas(p, 1);
+    } else if (c != ' ' && c != '\t') {
+        snprintf(p->error, sizeof(p->error), "Caractere inválido no plaintext: '%c'", c);
+        return -1;
+    }
+    return 0;
+}
+
+int pattern_parser_feed(pattern_parser_t* p, const char* data, size_t len) {
+    size_t k;
+    for (k = 0; k < len && !p->done; k++) {
+        char c = data[k];
+        if (c == '\r') continue;
+        if (p->skip_line) {
+            if (c == '\n') {
+                p->skip_line = 0;
+                p->line_start = 1;
+            }
+            continue;
+        }
+        if (p->in_header) {
+            if (c == '\n') {
+                p->header[p->header_len] = '\0';
+                p->in_header = 0;
+                p->line_start = 1;
+                if (cabecalho(p) < 0) return -1;
+            } else if (p->header_len + 1 < (int)sizeof(p->header)) {
+                p->header[p->header_len++] = c;
+            }
+            continue;
+        }
+        if (p->line_start) {
+            // Linhas iniciais decidem o formato: '#' e "x =" só existem no
+            // RLE, '!' (comentário) só no plaintext
+            if (p->format == PATTERN_AUTO) {
+                if (isspace((unsigned char)c)) continue;
+                if (c == '!' || c == '.' || c == 'O' || c == '*')
+                    p->format = PATTERN_PLAIN;
+                else
+                    p->format = PATTERN_RLE;
+            }
+            if (p->format == PATTERN_RLE && !p->in_data) {
+                if (c == '#') { p->skip_line = 1; continue; }
+                if (c == 'x') { p->in_header = 1; p->header_len = 0; p->header[p->header_len++] = c; continue; }
+                if (isspace((unsigned char)c)) continue;
+                p->in_data = 1;
+            }
+            p->line_start = 0;
+            if (p->format == PATTERN_PLAIN && c == '!') { p->skip_line = 1; continue; }
+        }
+        if ((p->format == PATTERN_RLE ? rle(p, c) : plaintext(p, c)) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int pattern_parser_finish(pattern_parser_t* p) {
+    if (p->in_header) {
+        p->header[p->header_len] = '\0';
+        p->in_header = 0;
+        if (cabecalho(p) < 0) return -1;
+    }
+    if (!p->tabul && alocar(p, 0, 0) < 0) return -1;
+    return 0;
+}
+
+// Célula viva quando o sorteio de 64 bits fica abaixo deste limite
+static uint64_t limite_densidade(double density) {
+    if (density >= 1.0) return UINT64_MAX;
+    if (density <= 0.0) return 0;
+    return (uint64_t)(density * 18446744073709551616.0);
+}
+
+int* pattern_soup(int tam, uint64_t seed, double density, long* alive) {
+    int* tabul = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    uint64_t limite = limite_densidade(density), s = splitmix64(seed);
+    long vivas = 0;
+    int i;
+
+    if (!tabul) return NULL;
+
+    #pragma omp parallel for schedule(static) reduction(+:vivas)
+    for (i = 1; i <= tam; i++) {
+        int* linha = tabul + ind2d(i,0);
+        int j;
+        for (j = 1; j <= tam; j++) {
+            int v = splitmix64(s ^ celula(i,j,tam)) < limite;
+            linha[j] = v;
+            vivas += v;
+        }
+    }
+    *alive = vivas;
+    return tabul;
+}
+
+void pattern_soup_packed(uint64_t* tabul, int tam, uint64_t seed, double density, long* alive) {
+    const int words = packed_words(tam);
+    uint64_t limite = limite_densidade(density), s = splitmix64(seed);
+    long vivas = 0;
+    int i;
+
+    #pragma omp parallel for schedule(static) reduction(+:vivas)
+    for (i = 1; i <= tam; i++) {
+        uint64_t* linha = tabul + (size_t)i*words;
+        int j;
+        for (j = 1; j <= tam; j++)
+            if (splitmix64(s ^ celula(i,j,tam)) < limite) {
+                linha[j/64] |= 1ULL << (j%64);
+                vivas++;
+            }
+    }
+    *alive = vivas;
+}
+
+void board_digest(const int* tabul, int tam, long* population, uint64_t* hash) {
+    long pop = 0;
+    uint64_t h = 0;
+    int i;
+
+    #pragma omp parallel for schedule(static) reduction(+:pop,h)
+    for (i = 1; i <= tam; i++) {
+        const int* linha = tabul + ind2d(i,0);
+        int j;
+        for (j = 1; j <= tam; j++)
+            if (linha[j]) {
+                pop++;
+                h += splitmix64(celula(i,j,tam));
+            }
+    }
+    *population = pop;
+    *hash = h;
+}
+
+// Mesmo hash de board_digest: a posição de cada bit é a do tabuleiro de int
+void board_digest_packed(const uint64_t* tabul, int tam, long* population, uint64_t* hash) {
+    const int words = packed_words(tam);
+    long pop = 0;
+    uint64_t h = 0;
+    int i;
+
+    #pragma omp parallel for schedule(static) reduction(+:pop,h)
+    for (i = 1; i <= tam; i++) {
+        const uint64_t* linha = tabul + (size_t)i*words;
+        int w;
+        for (w = 0; w < words; w++) {
+            uint64_t bits = linha[w];
+            while (bits) {
+                int j = w*64 + __builtin_ctzll(bits);
+                pop++;
+                h += splitmix64(celula(i,j,tam));
+                bits &= bits - 1;
+            }
+        }
+    }
+    *population = pop;
+    *hash = h;
+}
+
+int run_board(int** tabul, int tam, long start, long gens, const vida_regra_t* regra,
+              ckpt_t* ckpt, size_result_t* r, long* population, uint64_t* hash) {
+    int *tabulIn = *tabul, *tabulOut, *tmp;
+    uma_vida_fn fn = vida_regra_kernel(regra);
+    long g;
+    double t0, t1, t2, t3;
+
+    t0 = wall_time();
+    tabulOut = (int*)board_alloc(tam+2, (tam+2)*sizeof(int));
+    if (!tabulOut) return 0;
+    t1 = wall_time();
+
+    for (g = start; g < gens; ) {
+        fn(tabulIn, tabulOut, tam, 1, tam);
+        tmp = tabulIn; tabulIn = tabulOut; tabulOut = tmp;
+        g++;
+        if (run_checkpoint(g)) break;
+        if (ckpt && ckpt_due(ckpt))
+            ckpt_save_int(ckpt, tabulIn, g);
+    }
+    if (ckpt && g > ckpt->hdr->generation)
+        ckpt_save_int(ckpt, tabulIn, g);
+    t2 = wall_time();
+
+    board_digest(tabulIn, tam, population, hash);
+    t3 = wall_time();
+
+    r->correct = -1;
+    r->init = t1 - t0; r->comp = t2 - t1; r->check = t3 - t2;
+    r->work = 0.0;
+    board_release(tabulOut);
+    *tabul = tabulIn;
+    return 1;
+}
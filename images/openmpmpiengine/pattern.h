@@ -0,0 +1,73 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "life_rules.h"
+#include "checkpoint.h"
+
+// Tabuleiros iniciais além do glider: padrões enviados em RLE ou texto
+// puro (plaintext) e sopas aleatórias. O parser é incremental: recebe o
+// corpo em pedaços de qualquer tamanho, direto do socket, e escreve as
+// células no tabuleiro sem guardar o texto.
+
+#define PATTERN_DEFAULT_TAM 1024      // plaintext sem tam= e sopas
+#define PATTERN_MIN_TAM 64            // RLE sem tam=: 2x o padrão, no mínimo isto
+#define PATTERN_MAX_TAM 32768
+#define PATTERN_DEFAULT_DENSITY 0.5
+
+typedef enum { PATTERN_AUTO = 0, PATTERN_RLE, PATTERN_PLAIN } pattern_format_t;
+
+typedef struct {
+    pattern_format_t format;    // AUTO até a primeira linha significativa
+    int tam;                    // 0 até o tabuleiro ser alocado
+    int* tabul;                 // (tam+2) x (tam+2) da arena, bordas mortas
+    int x0, y0;                 // coluna e linha onde cai a célula (0,0) do padrão
+    long alive;                 // células vivas colocadas
+    long clipped;               // células fora do tabuleiro, descartadas
+    char rule[VIDA_REGRA_LEN];  // "rule = ..." do cabeçalho RLE
+    char error[128];
+
+    // Estado do parser entre pedaços
+    int req_tam, req_x, req_y;  // pedidos na query (0 / -1 = automático)
+    int line_start;             // próximo caractere abre uma linha
+    int skip_line;              // dentro de um comentário
+    int in_header;              // acumulando o cabeçalho "x = ..., y = ..."
+    int in_data;                // o RLE já passou dos cabeçalhos
+    int done;                   // '!' final do RLE
+    char header[256];
+    int header_len;
+    long count;                 // prefixo numérico do RLE
+    long row, col;              // posição relativa ao canto do padrão
+} pattern_parser_t;
+
+// tam = 0 escolhe pelo cabeçalho RLE (ou PATTERN_DEFAULT_TAM); x, y < 0
+// centralizam o padrão do RLE com cabeçalho e usam (1,1) no plaintext
+void pattern_parser_init(pattern_parser_t* p, pattern_format_t format, int tam, int x, int y);
+// Retorna 0, ou -1 com a mensagem em p->error
+int pattern_parser_feed(pattern_parser_t* p, const char* data, size_t len);
+// Fim do corpo: aloca o tabuleiro se o padrão não tinha células
+int pattern_parser_finish(pattern_parser_t* p);
+void pattern_parser_release(pattern_parser_t* p);
+
+// Sopa com cada célula viva com probabilidade 'density', sorteada por um
+// gerador contador (splitmix64 da posição com a semente): o resultado não
+// depende do número de threads. Tabuleiro da arena; NULL sem memória.
+int* pattern_soup(int tam, uint64_t seed, double density, long* alive);
+// A mesma sopa escrita num tabuleiro compactado já zerado (checkpoint.h)
+void pattern_soup_packed(uint64_t* tabul, int tam, uint64_t seed, double density, long* alive);
+
+// População e hash do tabuleiro (soma do splitmix64 de cada posição viva,
+// mod 2^64), com redução paralela e independentes do número de threads
+void board_digest(const int* tabul, int tam, long* population, uint64_t* hash);
+void board_digest_packed(const uint64_t* tabul, int tam, long* population, uint64_t* hash);
+
+// Roda da geração 'start' até 'gens' sobre 'tabul' (que passa a ser do
+// chamador de novo ao retornar, já com a geração final) com os kernels da
+// regra. Com 'ckpt', grava um checkpoint a cada intervalo e outro ao
+// parar. Não há gabarito: r->correct fica -1 e o resultado é a população
+// e o hash.
+int run_board(int** tabul, int tam, long start, long gens, const vida_regra_t* regra,
+              ckpt_t* ckpt, size_result_t* r, long* population, uint64_t* hash);
+
+#endif
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "result_cache.h"
+
+typedef struct {
+    char key[RESULT_CACHE_KEY_LEN];
+    cached_result_t value;
+    unsigned long uso;          // relógio do último acesso (LRU)
+    int ocupada;
+} cache_entry_t;
+
+static cache_entry_t* entradas = NULL;
+static int capacidade = 0, ocupadas = 0;
+static unsigned long relogio = 0, hits = 0, misses = 0;
+static const char* arquivo = NULL;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Busca linear: com poucas centenas de entradas custa menos que o
+// menor tabuleiro simulado
+static int procurar(const char* key) {
+    int k;
+    for (k = 0; k < capacidade; k++)
+        if (entradas[k].ocupada && strcmp(entradas[k].key, key) == 0)
+            return k;
+    return -1;
+}
+
+// Posição livre ou, com o cache cheio, a entrada menos usada recentemente
+static int vitima(void) {
+    int k, lru = 0;
+    for (k = 0; k < capacidade; k++) {
+        if (!entradas[k].ocupada) return k;
+        if (entradas[k].uso < entradas[lru].uso) lru = k;
+    }
+    return lru;
+}
+
+static void inserir(const char* key, const cached_result_t* value) {
+    int k = procurar(key);
+    if (k < 0) {
+        k = vitima();
+        if (!entradas[k].ocupada) ocupadas++;
+        snprintf(entradas[k].key, sizeof(entradas[k].key), "%s", key);
+        entradas[k].ocupada = 1;
+    }
+    entradas[k].value = *value;
+    entradas[k].uso = ++relogio;
+}
+
+// Uma entrada por linha: chave, correct, init, comp, check, work, extra
+static void carregar(void) {
+    char line[512];
+    FILE* f = fopen(arquivo, "r");
+    if (!f) return;
+
+    while (fgets(line, sizeof(line), f)) {
+        char key[RESULT_CACHE_KEY_LEN];
+        cached_result_t v;
+        memset(&v, 0, sizeof(v));
+        if (sscanf(line, "%95[^\t]\t%d\t%lf\t%lf\t%lf\t%lf\t%127[^\n]",
+                   key, &v.r.correct, &v.r.init, &v.r.comp, &v.r.check,
+                   &v.r.work, v.extra) >= 6)
+            inserir(key, &v);
+    }
+    fclose(f);
+    printf("Cache de resultados: %d entradas carregadas de %s\n", ocupadas, arquivo);
+}
+
+// Regrava o arquivo inteiro; o rename deixa o arquivo antigo intacto se o
+// processo morrer no meio da escrita
+static void persistir(void) {
+    char tmp[512];
+    FILE* f;
+    int k;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", arquivo);
+    f = fopen(tmp, "w");
+    if (!f) {
+        perror("Erro ao gravar cache de resultados");
+        return;
+    }
+    for (k = 0; k < capacidade; k++) {
+        const cache_entry_t* e = &entradas[k];
+        if (!e->ocupada) continue;
+        fprintf(f, "%s\t%d\t%.9g\t%.9g\t%.9g\t%.9g\t%s\n", e->key,
+                e->value.r.correct, e->value.r.init, e->value.r.comp,
+                e->value.r.check, e->value.r.work, e->value.extra);
+    }
+    if (fclose(f) != 0 || rename(tmp, arquivo) != 0)
+        perror("Erro ao gravar cache de resultados");
+}
+
+void result_cache_init(void) {
+    const char* env = getenv("RESULT_CACHE_ENTRIES");
+    capacidade = env && atoi(env) > 0 ? atoi(env) : RESULT_CACHE_DEFAULT_ENTRIES;
+    entradas = calloc(capacidade, sizeof(cache_entry_t));
+    if (!entradas) {
+        perror("Erro ao alocar cache de resultados");
+        capacidade = 0;
+        return;
+    }
+    arquivo = getenv("RESULT_CACHE_FILE");
+    if (arquivo && !*arquivo) arquivo = NULL;
+    if (arquivo) carregar();
+}
+
+int result_cache_get(const char* key, cached_result_t* out) {
+    int k;
+
+    pthread_mutex_lock(&cache_mutex);
+    k = capacidade ? procurar(key) : -1;
+    if (k >= 0) {
+        *out = entradas[k].value;
+        entradas[k].uso = ++relogio;
+        hits++;
+    } else {
+        misses++;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return k >= 0;
+}
+
+void result_cache_put(const char* key, const cached_result_t* value) {
+    pthread_mutex_lock(&cache_mutex);
+    if (capacidade) {
+        inserir(key, value);
+        if (arquivo) persistir();
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void result_cache_stats(result_cache_stats_t* stats) {
+    pthread_mutex_lock(&cache_mutex);
+    stats->entries = ocupadas;
+    stats->capacity = capacidade;
+    stats->hits = hits;
+    stats->misses = misses;
+    stats->persistent = arquivo != NULL;
+    pthread_mutex_unlock(&cache_mutex);
+}
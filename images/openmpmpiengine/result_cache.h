@@ -0,0 +1,39 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "game_of_life.h"
+
+// Cache LRU de resultados por tamanho. A simulação é determinística (o
+// mesmo glider de InitTabul), então o resultado de um tam com o mesmo modo
+// e parâmetros pode ser devolvido sem recalcular. A chave é uma string
+// montada pelo chamador ("mode=int,kernel=avx2,tam=1024", ...), o que
+// permite acrescentar padrão e gerações à chave sem mudar o cache.
+//
+// Com RESULT_CACHE_FILE definido, as entradas são carregadas na
+// inicialização e o arquivo é regravado (tmp + rename) a cada inserção,
+// para que um pod reiniciado já comece aquecido.
+
+#define RESULT_CACHE_DEFAULT_ENTRIES 256   // sobrescrito por RESULT_CACHE_ENTRIES
+#define RESULT_CACHE_KEY_LEN 96
+#define RESULT_CACHE_EXTRA_LEN 128
+
+typedef struct {
+    size_result_t r;
+    char extra[RESULT_CACHE_EXTRA_LEN];    // sufixo da linha (ativos, nós...)
+} cached_result_t;
+
+typedef struct {
+    int entries;
+    int capacity;
+    unsigned long hits;
+    unsigned long misses;
+    int persistent;             // 1 se há arquivo de persistência
+} result_cache_stats_t;
+
+void result_cache_init(void);
+// Retorna 1 e preenche 'out' se a chave estiver no cache
+int result_cache_get(const char* key, cached_result_t* out);
+void result_cache_put(const char* key, const cached_result_t* value);
+void result_cache_stats(result_cache_stats_t* stats);
+
+#endif
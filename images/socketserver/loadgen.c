@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+// Gerador de carga para o socket server (protocolo "<POWMIN> <POWMAX>
+// [engine]") ou direto para o /process de um engine HTTP. Roda contra
+// processos locais, sem cluster.
+//
+// Laço fechado (-c N): N clientes, cada um envia a próxima requisição
+// assim que a anterior termina. Laço aberto (-R taxa): as requisições têm
+// horário marcado (k/taxa) e a latência é medida a partir desse horário,
+// não do envio; se os clientes atrasam, a espera entra na latência.
+//
+// Correção de coordinated omission no laço fechado: um cliente lento
+// deixa de enviar as requisições que enviaria no período, então cada
+// latência L maior que o intervalo esperado I também registra L-I, L-2I,
+// ... (como o recordValueWithExpectedInterval do HdrHistogram). I vem de
+// -i; sem ele não há correção e só a latência medida é reportada (a
+// mediana das próprias amostras corrigiria por construção toda cauda
+// acima de 2x a mediana, mesmo com o servidor saudável).
+//
+// Uso: ./loadgen [-m socket|http] [-H host] [-P porta] [-e engine]
+//                [-p POWMIN-POWMAX] [-c clientes] [-R req/s] [-n total]
+//                [-d segundos] [-i ms] [-o saida.json]
+// Ex.: ./loadgen -c 8 -n 200 -p 3-6 -e openmp
+//      ./loadgen -m http -P 8081 -R 50 -d 10 -p 3-8
+
+#define LOADGEN_DEFAULT_HOST "127.0.0.1"
+#define LOADGEN_DEFAULT_SOCKET_PORT 8080
+#define LOADGEN_DEFAULT_HTTP_PORT 8081
+#define LOADGEN_DEFAULT_CLIENTS 4
+#define LOADGEN_DEFAULT_OPEN_CLIENTS 64   // conexões simultâneas no laço aberto
+#define LOADGEN_DEFAULT_REQUESTS 100      // laço fechado sem -n nem -d
+#define LOADGEN_DEFAULT_DURATION 10.0     // laço aberto sem -n nem -d
+#define LOADGEN_TIMEOUT_S 120
+#define LOADGEN_MAX_SYNTHETIC 10000       // amostras corrigidas por medição
+
+typedef struct {
+    double* v;
+    size_t n, cap;
+} amostras_t;
+
+typedef struct {
+    pthread_t thread;
+    amostras_t lat;     // ms, a partir do horário pretendido
+    unsigned long ok, falhas, erros_conexao;
+} cliente_t;
+
+static struct {
+    int http;
+    const char* host;
+    int port;
+    const char* engine;
+    int powmin, powmax;
+    int clientes;
+    double taxa;        // > 0: laço aberto
+    long total;         // 0: limitado só pela duração
+    double duracao;     // 0: limitado só pelo total
+    double intervalo;   // ms, de -i; 0 = sem correção de coordinated omission
+    const char* saida;
+} cfg = { 0, LOADGEN_DEFAULT_HOST, 0, NULL, 3, 6, 0, 0.0, 0, 0.0, 0.0, NULL };
+
+static struct addrinfo* destino = NULL;
+static atomic_long proxima = 0;
+static double inicio, fim;
+
+static double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void esperar_ate(double t) {
+    double falta = t - agora();
+    if (falta > 0) {
+        struct timespec ts = { (time_t)falta, (long)((falta - (time_t)falta) * 1e9) };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void adicionar(amostras_t* a, double v) {
+    if (a->n == a->cap) {
+        size_t cap = a->cap ? a->cap * 2 : 1024;
+        double* novo = realloc(a->v, cap * sizeof(double));
+        if (!novo) return;
+        a->v = novo;
+        a->cap = cap;
+    }
+    a->v[a->n++] = v;
+}
+
+static void send_all(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= n;
+    }
+}
+
+// Uma requisição completa numa conexão nova. Retorna 1 com sucesso, 0
+// com falha reportada pelo servidor e -1 se não conectou
+static int requisicao(void) {
+    char req[512], buf[4096];
+    char* resp = NULL;
+    size_t len = 0, cap = 0;
+    int sock, ok;
+    struct timeval tv = { LOADGEN_TIMEOUT_S, 0 };
+
+    sock = socket(destino->ai_family, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(sock, destino->ai_addr, destino->ai_addrlen) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    int n;
+    if (cfg.http)
+        n = snprintf(req, sizeof(req),
+                     "GET /process?powmin=%d&powmax=%d%s%s HTTP/1.1\r\n"
+                     "Host: %s\r\n"
+                     "Connection: close\r\n"
+                     "\r\n",
+                     cfg.powmin, cfg.powmax, cfg.engine ? "&engine=" : "",
+                     cfg.engine ? cfg.engine : "", cfg.host);
+    else
+        n = snprintf(req, sizeof(req), "%d %d %s", cfg.powmin, cfg.powmax,
+                     cfg.engine ? cfg.engine : "auto");
+    send_all(sock, req, n);
+
+    // Lê até o servidor fechar a conexão
+    while (1) {
+        ssize_t r = recv(sock, buf, sizeof(buf), 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        if (len + r + 1 > cap) {
+            size_t novo = cap ? cap * 2 : 8192;
+            while (novo < len + r + 1) novo *= 2;
+            char* t = realloc(resp, novo);
+            if (!t) break;
+            resp = t;
+            cap = novo;
+        }
+        memcpy(resp + len, buf, r);
+        len += r;
+        resp[len] = '\0';
+    }
+    close(sock);
+
+    if (!resp) return 0;
+    if (cfg.http)
+        ok = strncmp(resp, "HTTP/1.1 200", 12) == 0 && strstr(resp, "\"success\":true") != NULL;
+    else
+        ok = strstr(resp, "Status: SUCESSO") != NULL;
+    free(resp);
+    return ok;
+}
+
+static void* cliente_loop(void* arg) {
+    cliente_t* c = (cliente_t*)arg;
+
+    while (1) {
+        long k = atomic_fetch_add(&proxima, 1);
+        double alvo;
+
+        if (cfg.total > 0 && k >= cfg.total) break;
+        if (cfg.taxa > 0) {
+            alvo = inicio + k / cfg.taxa;
+            if (cfg.duracao > 0 && alvo >= fim) break;
+            esperar_ate(alvo);
+        } else {
+            alvo = agora();
+            if (cfg.duracao > 0 && alvo >= fim) break;
+        }
+
+        int r = requisicao();
+        adicionar(&c->lat, (agora() - alvo) * 1000.0);
+        if (r > 0) c->ok++;
+        else if (r == 0) c->falhas++;
+        else c->erros_conexao++;
+    }
+    return NULL;
+}
+
+static int comparar_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Percentil pelo posto mais próximo, sobre amostras ordenadas
+static double percentil(const amostras_t* a, double p) {
+    size_t k;
+    if (a->n == 0) return 0.0;
+    k = (size_t)(p / 100.0 * a->n + 0.5);
+    if (k > 0) k--;
+    if (k >= a->n) k = a->n - 1;
+    return a->v[k];
+}
+
+static const double percentis[] = { 50.0, 90.0, 99.0, 99.9 };
+#define NUM_PERCENTIS (int)(sizeof(percentis) / sizeof(percentis[0]))
+
+static void imprimir_percentis(const char* titulo, const amostras_t* a) {
+    int k;
+    printf("%-22s", titulo);
+    for (k = 0; k < NUM_PERCENTIS; k++)
+        printf("  p%-4g %9.3f ms", percentis[k], percentil(a, percentis[k]));
+    printf("  max %9.3f ms\n", a->n ? a->v[a->n - 1] : 0.0);
+}
+
+static void json_percentis(FILE* f, const char* nome, const amostras_t* a) {
+    int k;
+    fprintf(f, "\"%s\":{", nome);
+    for (k = 0; k < NUM_PERCENTIS; k++)
+        fprintf(f, "\"p%g\":%.3f,", percentis[k], percentil(a, percentis[k]));
+    fprintf(f, "\"max\":%.3f}", a->n ? a->v[a->n - 1] : 0.0);
+}
+
+int main(int argc, char* argv[]) {
+    cliente_t* clientes;
+    amostras_t todas = { 0 }, corrigidas = { 0 };
+    unsigned long ok = 0, falhas = 0, erros = 0;
+    char porta[16];
+    struct addrinfo hints = { 0 };
+    int opt, k;
+    size_t j;
+
+    while ((opt = getopt(argc, argv, "m:H:P:e:p:c:R:n:d:i:o:")) != -1) {
+        switch (opt) {
+            case 'm': cfg.http = strcmp(optarg, "http") == 0; break;
+            case 'H': cfg.host = optarg; break;
+            case 'P': cfg.port = atoi(optarg); break;
+            case 'e': cfg.engine = optarg; break;
+            case 'p':
+                if (sscanf(optarg, "%d-%d", &cfg.powmin, &cfg.powmax) == 1) cfg.powmax = cfg.powmin;
+                break;
+            case 'c': cfg.clientes = atoi(optarg); break;
+            case 'R': cfg.taxa = atof(optarg); break;
+            case 'n': cfg.total = atol(optarg); break;
+            case 'd': cfg.duracao = atof(optarg); break;
+            case 'i': cfg.intervalo = atof(optarg); break;
+            case 'o': cfg.saida = optarg; break;
+            default:
+                fprintf(stderr, "Uso: %s [-m socket|http] [-H host] [-P porta] [-e engine] "
+                        "[-p POWMIN-POWMAX] [-c clientes] [-R req/s] [-n total] [-d segundos] "
+                        "[-i ms] [-o saida.json]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (cfg.port <= 0)
+        cfg.port = cfg.http ? LOADGEN_DEFAULT_HTTP_PORT : LOADGEN_DEFAULT_SOCKET_PORT;
+    if (cfg.clientes <= 0)
+        cfg.clientes = cfg.taxa > 0 ? LOADGEN_DEFAULT_OPEN_CLIENTS : LOADGEN_DEFAULT_CLIENTS;
+    if (cfg.total <= 0 && cfg.duracao <= 0) {
+        if (cfg.taxa > 0) cfg.duracao = LOADGEN_DEFAULT_DURATION;
+        else cfg.total = LOADGEN_DEFAULT_REQUESTS;
+    }
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(porta, sizeof(porta), "%d", cfg.port);
+    if (getaddrinfo(cfg.host, porta, &hints, &destino) != 0) {
+        fprintf(stderr, "Não foi possível resolver %s\n", cfg.host);
+        return 1;
+    }
+
+    printf("Carga %s em %s:%d (%s), POWMIN=%d, POWMAX=%d, engine=%s\n",
+           cfg.taxa > 0 ? "em laço aberto" : "em laço fechado", cfg.host, cfg.port,
+           cfg.http ? "HTTP /process" : "protocolo do socket server",
+           cfg.powmin, cfg.powmax, cfg.engine ? cfg.engine : (cfg.http ? "padrão" : "auto"));
+    if (cfg.taxa > 0)
+        printf("Taxa: %.2f req/s, até %d conexões simultâneas\n", cfg.taxa, cfg.clientes);
+    else
+        printf("Clientes: %d\n", cfg.clientes);
+
+    clientes = calloc(cfg.clientes, sizeof(cliente_t));
+    if (!clientes) {
+        perror("Erro ao alocar clientes");
+        return 1;
+    }
+    inicio = agora();
+    fim = inicio + cfg.duracao;
+    for (k = 0; k < cfg.clientes; k++) {
+        if (pthread_create(&clientes[k].thread, NULL, cliente_loop, &clientes[k]) != 0) {
+            perror("Erro ao criar cliente");
+            return 1;
+        }
+    }
+    for (k = 0; k < cfg.clientes; k++) {
+        pthread_join(clientes[k].thread, NULL);
+        for (j = 0; j < clientes[k].lat.n; j++)
+            adicionar(&todas, clientes[k].lat.v[j]);
+        ok += clientes[k].ok;
+        falhas += clientes[k].falhas;
+        erros += clientes[k].erros_conexao;
+        free(clientes[k].lat.v);
+    }
+    double decorrido = agora() - inicio;
+    qsort(todas.v, todas.n, sizeof(double), comparar_double);
+
+    // O laço aberto já mede a partir do horário pretendido; no fechado as
+    // amostras omitidas são reconstruídas a partir do intervalo de -i
+    double intervalo = cfg.taxa > 0 ? 0.0 : cfg.intervalo;
+    if (intervalo > 0) {
+        for (j = 0; j < todas.n; j++) {
+            double v = todas.v[j];
+            int extras = 0;
+            adicionar(&corrigidas, v);
+            for (v -= intervalo; v >= intervalo && extras < LOADGEN_MAX_SYNTHETIC; v -= intervalo, extras++)
+                adicionar(&corrigidas, v);
+        }
+        qsort(corrigidas.v, corrigidas.n, sizeof(double), comparar_double);
+    }
+
+    printf("\nRequisições: %zu em %.3f s (%.2f req/s) - sucesso %lu, falha %lu, erro de conexão %lu\n",
+           todas.n, decorrido, decorrido > 0 ? todas.n / decorrido : 0.0, ok, falhas, erros);
+    if (cfg.taxa > 0) {
+        imprimir_percentis("Latência (corrigida):", &todas);
+    } else {
+        imprimir_percentis("Latência medida:", &todas);
+        if (intervalo > 0) {
+            printf("Intervalo esperado para a correção: %.3f ms\n", intervalo);
+            imprimir_percentis("Latência corrigida:", &corrigidas);
+        } else {
+            printf("Sem -i: latência não corrigida para coordinated omission\n");
+        }
+    }
+
+    if (cfg.saida) {
+        FILE* f = fopen(cfg.saida, "w");
+        if (!f) {
+            perror("Erro ao gravar resultados");
+        } else {
+            fprintf(f, "{\"mode\":\"%s\",\"loop\":\"%s\",\"host\":\"%s\",\"port\":%d,"
+                    "\"powmin\":%d,\"powmax\":%d,\"engine\":\"%s\",\"clients\":%d,\"rate\":%.3f,"
+                    "\"requests\":%zu,\"success\":%lu,\"failed\":%lu,\"connect_errors\":%lu,"
+                    "\"elapsed\":%.3f,\"throughput\":%.3f,\"expected_interval_ms\":%.3f,",
+                    cfg.http ? "http" : "socket", cfg.taxa > 0 ? "open" : "closed",
+                    cfg.host, cfg.port, cfg.powmin, cfg.powmax, cfg.engine ? cfg.engine : "",
+                    cfg.clientes, cfg.taxa, todas.n, ok, falhas, erros, decorrido,
+                    decorrido > 0 ? todas.n / decorrido : 0.0, intervalo);
+            json_percentis(f, "measured", &todas);
+            // Laço fechado sem -i: sem números corrigidos
+            if (cfg.taxa > 0 || intervalo > 0) {
+                fprintf(f, ",");
+                json_percentis(f, "corrected", cfg.taxa > 0 ? &todas : &corrigidas);
+            }
+            fprintf(f, "}\n");
+            fclose(f);
+            printf("Resultados gravados em %s\n", cfg.saida);
+        }
+    }
+
+    freeaddrinfo(destino);
+    free(todas.v);
+    free(corrigidas.v);
+    free(clientes);
+    return falhas + erros > 0;
+}
@@ -0,0 +1,35 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+
+// Contadores e histogramas no formato de texto do Prometheus (/metrics).
+// Cada thread escreve no seu próprio shard (escolhido na primeira
+// escrita), com operações atômicas relaxed e sem lock; a renderização
+// soma os shards. Os histogramas têm baldes logarítmicos: o balde k
+// conta as amostras <= min * 2^k, mais o +Inf.
+//
+// As métricas são registradas na inicialização, antes de haver threads
+// escrevendo; nomes iguais com rótulos diferentes devem ser registrados
+// em sequência para compartilhar HELP/TYPE.
+
+#define METRICS_MAX 64
+#define METRICS_SHARDS 64
+#define METRICS_BUCKETS 32
+
+typedef struct metric metric_t;
+
+// 'labels' vai entre chaves na saída (ex.: "phase=\"init\""), ou NULL
+metric_t* metrics_counter(const char* name, const char* labels, const char* help);
+metric_t* metrics_histogram(const char* name, const char* labels, const char* help, double min);
+
+void metrics_add(metric_t* counter, double value);
+void metrics_observe(metric_t* histogram, double value);
+
+// Texto de todas as métricas registradas, alocado com malloc; o chamador
+// pode acrescentar seus próprios gauges com metrics_appendf
+char* metrics_render(size_t* len, size_t* cap);
+void metrics_appendf(char** text, size_t* len, size_t* cap, const char* fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#endif
@@ -7,13 +7,44 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
 #include <time.h>
 #include <sys/time.h>
+#include <strings.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "metrics.h"
 
 #define PORT 8080
 #define BUFFER_SIZE 2048
-#define ELASTICSEARCH_HOST "192.168.122.1"
-#define ELASTICSEARCH_PORT 9200
+#define DEFAULT_ELASTICSEARCH_HOST "192.168.122.1"   // sobrescrito por ELASTICSEARCH_HOST
+#define DEFAULT_ELASTICSEARCH_PORT 9200              // sobrescrito por ELASTICSEARCH_PORT
+#define DEFAULT_ELASTICSEARCH_INDEX "pspd-metrics"   // sobrescrito por ELASTICSEARCH_INDEX
+#define METRICS_RING_SIZE 1024        // potência de 2
+#define METRICS_DOC_SIZE 2048
+#define METRICS_BATCH_MAX 100         // documentos por requisição _bulk
+#define METRICS_FLUSH_MS 1000         // espera máxima de um documento no lote
+#define METRICS_IDLE_SLEEP_MS 50
+#define METRICS_IO_TIMEOUT_S 5
+#define ROUTER_MAX_POW 15             // maior POWMAX aceito
+#define ROUTER_EWMA_ALPHA 0.3         // peso da amostra nova nas médias móveis
+#define ROUTER_PROBE_INTERVAL_MS 5000 // intervalo entre sondagens de /health
+#define ROUTER_PROBE_TIMEOUT_S 2
+#define POOL_MAX_IDLE 8              // conexões ociosas guardadas por engine
+#define POOL_IDLE_TIMEOUT_MS 30000   // ociosas há mais tempo são fechadas
+#define JOB_POLL_MIN_MS 5            // primeira consulta a GET /jobs/{id}; dobra a cada uma
+#define JOB_POLL_MS 200              // intervalo máximo entre consultas
+#define JOB_BODY_MAX (1 << 20)       // maior resposta aceita de /jobs
+#define MAX_REPLICAS 8               // réplicas do engine OpenMP usadas no scatter-gather
+#define SCATTER_ATTEMPTS 2           // tentativas de um tam quando a réplica cai
+#define DEFAULT_DEADLINE_BASE_S 10.0     // sobrescrito por DEADLINE_BASE_S
+#define DEFAULT_DEADLINE_MIN_RATE 5e7    // células/s; sobrescrito por DEADLINE_MIN_RATE
+#define CONNECT_TIMEOUT_MS 2000      // connect com o engine, limitado também pelo prazo
+#define CANCEL_TIMEOUT_MS 2000       // DELETE /jobs/{id} de um job abandonado
+#define IO_TIMEOUT_MS 3000           // espera por bytes da API de jobs, limitada também pelo prazo
+#define HEDGE_SAMPLES 32             // latências guardadas por réplica e tam para o p95
+#define HEDGE_MIN_SAMPLES 5          // sem isso não há p95 e o tam não tem hedge
 
 typedef struct {
     int socket;
@@ -21,10 +52,134 @@ typedef struct {
     int thread_id;
 } client_data_t;
 
+// Conexão keep-alive ociosa, pronta para a próxima requisição
+typedef struct {
+    int fd;
+    long long last_used;
+} pooled_conn_t;
+
+// Engine de destino com seu pool de conexões persistentes e o estado
+// usado pelo roteador; tudo protegido pelo mutex do engine
+typedef struct {
+    const char* name;
+    const char* host;
+    int port;
+    pooled_conn_t idle[POOL_MAX_IDLE];
+    int nidle;
+    unsigned long opened, reused;
+    int async_jobs;             // aceita POST /jobs (job cancelável)
+    int scatter;                // intervalos podem ser divididos entre as réplicas
+    int healthy;                // última sondagem ou requisição deu certo
+    int outstanding;            // requisições em andamento
+    double outstanding_time;    // soma das estimativas das em andamento
+    double ewma_size[ROUTER_MAX_POW + 1];   // segundos por tamanho (0 = sem amostra)
+    double ewma_rate;           // segundos por atualização de célula
+    double ewma_overhead;       // custo fixo por requisição, em segundos
+    float latency[ROUTER_MAX_POW + 1][HEDGE_SAMPLES];   // últimas chamadas de um tam só, em segundos
+    int latency_count[ROUTER_MAX_POW + 1];
+    metric_t* upstream_time;    // histograma de /metrics (sem o mutex)
+    pthread_mutex_t mutex;
+} engine_t;
+
+// As taxas e custos fixos iniciais são só pontos de partida (o Spark paga
+// segundos de agendamento por job); as médias móveis os substituem
+engine_t engines[] = {
+    { .name = "openmp", .host = "10.108.84.193", .port = 8081, .async_jobs = 1, .scatter = 1, .healthy = 1,  // IP do openmpmpi-service
+      .ewma_rate = 1e-9, .ewma_overhead = 0.01, .mutex = PTHREAD_MUTEX_INITIALIZER },
+    { .name = "spark",  .host = "10.101.15.95",  .port = 8082, .healthy = 1,  // IP do spark-service
+      .ewma_rate = 1e-7, .ewma_overhead = 2.0, .mutex = PTHREAD_MUTEX_INITIALIZER },
+};
+#define NUM_ENGINES (int)(sizeof(engines) / sizeof(engines[0]))
+
+// Pod individual do engine OpenMP. O Service distribui conexões, mas para
+// dividir um intervalo entre as réplicas é preciso falar com cada uma. A
+// lista vem de OPENMP_REPLICAS: IPs separados por vírgula ou o nome de um
+// Service headless, resolvido de novo a cada sondagem.
+typedef struct {
+    engine_t engine;
+    char name[32];
+    char host[INET_ADDRSTRLEN];
+    int present;                // apareceu na última resolução
+} replica_t;
+
+replica_t replicas[MAX_REPLICAS];
+int num_replicas = 0;           // slots já usados; só a sondagem acrescenta
+const char* replicas_spec = NULL;
+pthread_mutex_t replicas_mutex = PTHREAD_MUTEX_INITIALIZER;
+atomic_int scatter_width = 0;   // réplicas presentes e saudáveis
+
 int active_clients = 0;
 int total_requests = 0;
+unsigned long coalesced_requests = 0;   // pedidos atendidos por chamada de outro
+atomic_ulong replica_calls, hedged_calls, hedge_wins;  // sub-pedidos do scatter e duplicatas
+
+// Prazo da chamada em andamento nesta thread (ms de get_timestamp_ms; 0 =
+// sem prazo): connect, leituras do engine e consultas de jobs param nele
+__thread long long call_deadline = 0;
+double deadline_base = DEFAULT_DEADLINE_BASE_S;
+double deadline_min_rate = DEFAULT_DEADLINE_MIN_RATE;
 pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Destino das métricas, lido do ambiente na inicialização
+const char* elasticsearch_host = DEFAULT_ELASTICSEARCH_HOST;
+int elasticsearch_port = DEFAULT_ELASTICSEARCH_PORT;
+const char* elasticsearch_index = DEFAULT_ELASTICSEARCH_INDEX;
+
+// Fila circular sem lock (várias threads produzem, o shipper consome):
+// cada posição tem um número de sequência que diz se ela está livre para
+// o produtor da volta 'pos' ou pronta para o consumidor
+typedef struct {
+    atomic_ulong seq;
+    char doc[METRICS_DOC_SIZE];
+} metrics_slot_t;
+
+typedef struct {
+    metrics_slot_t slots[METRICS_RING_SIZE];
+    atomic_ulong tail;          // próxima posição a produzir
+    unsigned long head;         // próxima posição a consumir (só o shipper)
+    atomic_ulong enqueued, dropped, sent, failed, batches;
+} metrics_ring_t;
+
+metrics_ring_t metrics_ring;
+
+// Séries de /metrics, registradas em register_metrics antes das threads
+struct {
+    metric_t *ok, *failed, *invalid, *coalesced, *scattered, *scatter_parts;
+    metric_t *hedges, *hedge_wins, *deadline_exceeded;
+    metric_t *time_ok, *time_failed;
+} prom;
+
+void register_metrics(void) {
+    const char* req = "Pedidos de clientes por resultado";
+    const char* tempo = "Tempo de ponta a ponta do pedido, visto pelo socket server";
+    int k;
+
+    prom.ok = metrics_counter("socket_requests_total", "result=\"success\"", req);
+    prom.failed = metrics_counter("socket_requests_total", "result=\"failure\"", req);
+    prom.invalid = metrics_counter("socket_requests_total", "result=\"invalid\"", req);
+    prom.coalesced = metrics_counter("socket_coalesced_total", NULL,
+                                     "Pedidos atendidos pela chamada de outro cliente");
+    prom.scattered = metrics_counter("socket_scatter_total", NULL,
+                                     "Pedidos divididos por tam entre as replicas do engine OpenMP");
+    prom.scatter_parts = metrics_counter("socket_scatter_parts_total", NULL,
+                                         "Sub-pedidos de um tam enviados as replicas");
+    prom.hedges = metrics_counter("socket_hedges_total", NULL,
+                                  "Duplicatas de um tam disparadas apos o p95 da replica");
+    prom.hedge_wins = metrics_counter("socket_hedge_wins_total", NULL,
+                                      "Duplicatas que terminaram antes da chamada original");
+    prom.deadline_exceeded = metrics_counter("socket_deadline_exceeded_total", NULL,
+                                             "Chamadas a engines interrompidas pelo prazo");
+    prom.time_ok = metrics_histogram("socket_request_seconds", "result=\"success\"", tempo, 1e-3);
+    prom.time_failed = metrics_histogram("socket_request_seconds", "result=\"failure\"", tempo, 1e-3);
+    for (k = 0; k < NUM_ENGINES; k++) {
+        char* label = malloc(64);
+        if (!label) continue;
+        snprintf(label, 64, "engine=\"%s\"", engines[k].name);
+        engines[k].upstream_time = metrics_histogram("socket_upstream_seconds", label,
+                "Duracao da chamada ao engine, incluindo conexao e relay", 1e-3);
+    }
+}
+
 // Função para obter timestamp atual em formato ISO 8601
 void get_iso_timestamp(char* buffer, size_t size) {
     time_t now = time(NULL);
@@ -39,22 +194,101 @@ long long get_timestamp_ms() {
     return (long long)(tv.tv_sec) * 1000 + (long long)(tv.tv_usec) / 1000;
 }
 
-// Enviar métricas para ElasticSearch
+void metrics_ring_init(void) {
+    unsigned long k;
+    for (k = 0; k < METRICS_RING_SIZE; k++)
+        atomic_init(&metrics_ring.slots[k].seq, k);
+    atomic_init(&metrics_ring.tail, 0);
+    metrics_ring.head = 0;
+}
+
+// Coloca um documento na fila; com a fila cheia o documento é descartado
+// e contado, para que um ElasticSearch lento nunca atrase o cliente
+int metrics_enqueue(const char* doc) {
+    unsigned long pos = atomic_load_explicit(&metrics_ring.tail, memory_order_relaxed);
+    metrics_slot_t* slot;
+    
+    while (1) {
+        slot = &metrics_ring.slots[pos & (METRICS_RING_SIZE - 1)];
+        unsigned long seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&metrics_ring.tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add(&metrics_ring.dropped, 1);
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&metrics_ring.tail, memory_order_relaxed);
+        }
+    }
+    snprintf(slot->doc, sizeof(slot->doc), "%s", doc);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    atomic_fetch_add(&metrics_ring.enqueued, 1);
+    return 1;
+}
+
+// Tira o próximo documento da fila (só o shipper chama); 0 se vazia
+int metrics_dequeue(char* doc, size_t size) {
+    unsigned long pos = metrics_ring.head;
+    metrics_slot_t* slot = &metrics_ring.slots[pos & (METRICS_RING_SIZE - 1)];
+    
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1)
+        return 0;
+    snprintf(doc, size, "%s", slot->doc);
+    atomic_store_explicit(&slot->seq, pos + METRICS_RING_SIZE, memory_order_release);
+    metrics_ring.head = pos + 1;
+    return 1;
+}
+
+// Copia 'src' escapado para dentro de uma string JSON; se não couber, é
+// cortado sem partir um escape. Um documento inválido derrubaria o lote
+// _bulk inteiro.
+void json_escape(char* dst, size_t size, const char* src) {
+    size_t pos = 0;
+    for (; *src; src++) {
+        unsigned char c = (unsigned char)*src;
+        char esc[8];
+        int n;
+        if (c == '"' || c == '\\') n = snprintf(esc, sizeof(esc), "\\%c", c);
+        else if (c == '\n') n = snprintf(esc, sizeof(esc), "\\n");
+        else if (c < 0x20) n = snprintf(esc, sizeof(esc), "\\u%04x", c);
+        else { esc[0] = c; n = 1; }
+        if (pos + n >= size) break;
+        memcpy(dst + pos, esc, n);
+        pos += n;
+    }
+    dst[pos] = '\0';
+}
+
+// Enviar métricas para ElasticSearch: o documento vai para a fila e o
+// shipper o envia em lote pela API _bulk, fora do caminho da requisição
 int send_metrics_to_elasticsearch(const char* engine, int powmin, int powmax, 
                                  int request_id, int success, double processing_time, 
-                                 const char* client_ip, const char* error_msg) {
-    int sock;
-    struct sockaddr_in server_addr;
-    char request[2048];
-    char response[1024];
+                                 const char* client_ip, const char* error_msg,
+                                 const char* routing, int coalesced, double deadline) {
     char timestamp[64];
-    char json_body[1024];
+    char json_body[METRICS_DOC_SIZE];
+    char engine_esc[64], ip_esc[64], error_esc[768];
+    int n;
+    unsigned long calls = atomic_load(&replica_calls);
+    // Fração das chamadas às réplicas que ganharam uma duplicata
+    double hedge_rate = calls ? (double)atomic_load(&hedged_calls) / calls : 0.0;
     
     // Obter timestamp atual
     get_iso_timestamp(timestamp, sizeof(timestamp));
     
-    // Criar JSON com métricas
-    snprintf(json_body, sizeof(json_body),
+    // Campos de texto escapados; 'routing' já é um objeto JSON montado aqui
+    json_escape(engine_esc, sizeof(engine_esc), engine);
+    json_escape(ip_esc, sizeof(ip_esc), client_ip);
+    if (error_msg)
+        json_escape(error_esc, sizeof(error_esc), error_msg);
+    
+    // Criar JSON com métricas; cortado no meio seria inválido: sem routing
+    // se não couber
+again:
+    n = snprintf(json_body, sizeof(json_body),
         "{"
         "\"timestamp\":\"%s\","
         "\"engine\":\"%s\","
@@ -65,146 +299,1691 @@ int send_metrics_to_elasticsearch(const char* engine, int powmin, int powmax,
         "\"processing_time\":%.6f,"
         "\"client_ip\":\"%s\","
         "\"active_clients\":%d,"
-        "\"total_requests\":%d"
+        "\"total_requests\":%d,"
+        "\"coalesced\":%s,"
+        "\"coalesced_requests\":%lu,"
+        "\"deadline\":%.3f,"
+        "\"hedge_rate\":%.4f"
         "%s%s%s"
+        "%s%s"
         "}",
-        timestamp, engine, powmin, powmax, request_id,
-        success ? "true" : "false", processing_time, client_ip,
+        timestamp, engine_esc, powmin, powmax, request_id,
+        success ? "true" : "false", processing_time, ip_esc,
         active_clients, total_requests,
+        coalesced ? "true" : "false", coalesced_requests, deadline, hedge_rate,
         error_msg ? ",\"error\":\"" : "",
-        error_msg ? error_msg : "",
-        error_msg ? "\"" : ""
+        error_msg ? error_esc : "",
+        error_msg ? "\"" : "",
+        routing ? ",\"routing\":" : "",
+        routing ? routing : ""
     );
+    if (n >= (int)sizeof(json_body)) {
+        if (!routing) return 0;
+        routing = NULL;
+        goto again;
+    }
     
-    // Criar socket
-    sock = socket(AF_INET, SOCK_STREAM, 0);
+    return metrics_enqueue(json_body);
+}
+
+// Envia tudo, repetindo send em envios parciais; 0 se o envio falhou
+// (com o motivo em errno)
+int send_all(int socket, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(socket, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return 0;
+        data += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Pedido em andamento num engine (singleflight). O líder faz a chamada e
+// tudo o que repassa ao seu cliente também fica em 'out', de onde os
+// seguidores (pedidos idênticos que chegaram durante a chamada) leem.
+typedef struct flight {
+    int powmin, powmax;
+    engine_t* engine;
+    int leader_socket, leader_id;   // leader_socket -1: saída só guardada (scatter)
+    struct flight* parent;          // pedido do cliente, num sub-pedido do scatter
+    atomic_int cancel;              // sub-pedido que perdeu a corrida de um hedge
+    atomic_int leader_gone;         // envio ao cliente do líder falhou (EPIPE/ECONNRESET)
+    char* out;
+    size_t len, cap;
+    int done, success;
+    char error[1024];
+    int refs;                   // líder + seguidores ainda lendo
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct flight* next;
+} flight_t;
+
+flight_t* flights = NULL;       // pedidos em andamento
+pthread_mutex_t flights_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Saída do líder: vai para o seu cliente e fica guardada para os seguidores
+void flight_write(flight_t* flight, const char* data, size_t len) {
+    if (flight->leader_socket >= 0 && !atomic_load(&flight->leader_gone) &&
+        !send_all(flight->leader_socket, data, len) && (errno == EPIPE || errno == ECONNRESET))
+        atomic_store(&flight->leader_gone, 1);
+    
+    pthread_mutex_lock(&flight->mutex);
+    if (flight->len + len > flight->cap) {
+        size_t cap = flight->cap ? flight->cap : BUFFER_SIZE;
+        while (cap < flight->len + len) cap *= 2;
+        char* out = realloc(flight->out, cap);
+        if (out) {
+            flight->out = out;
+            flight->cap = cap;
+        }
+    }
+    if (flight->len + len <= flight->cap) {
+        memcpy(flight->out + flight->len, data, len);
+        flight->len += len;
+    }
+    pthread_cond_broadcast(&flight->cond);
+    pthread_mutex_unlock(&flight->mutex);
+}
+
+// Leitor com buffer sobre o socket do engine: linhas de cabeçalho e
+// tamanhos de chunk são lidos linha a linha, o corpo em pedaços
+typedef struct {
+    int sock;
+    char buf[BUFFER_SIZE];
+    int start, end;
+    int io_timeout;         // ms sem bytes até desistir (0 = só o prazo)
+    int timed_out;          // a última leitura esgotou io_timeout
+} http_reader_t;
+
+int reader_fill(http_reader_t* r) {
+    if (r->start > 0) {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->start = 0;
+    }
+    if (r->end == BUFFER_SIZE) return -1;   // linha maior que o buffer
+    if (call_deadline > 0 || r->io_timeout > 0) {
+        // Respostas do /process só chegam quando o tam termina, então lá
+        // vale só o prazo; a API de jobs e o /health respondem na hora
+        struct pollfd pfd = { .fd = r->sock, .events = POLLIN };
+        long long remaining = call_deadline > 0 ? call_deadline - get_timestamp_ms() : 1 << 30;
+        int ready;
+        if (remaining > (1 << 30)) remaining = 1 << 30;
+        if (remaining <= 0) return -1;
+        if (r->io_timeout > 0 && r->io_timeout < remaining) {
+            ready = poll(&pfd, 1, r->io_timeout);
+            r->timed_out = ready == 0;
+        } else {
+            ready = poll(&pfd, 1, (int)remaining);
+        }
+        if (ready <= 0) return -1;
+    }
+    ssize_t n = recv(r->sock, r->buf + r->end, BUFFER_SIZE - r->end, 0);
+    if (n <= 0) return -1;
+    r->end += n;
+    return n;
+}
+
+// Lê uma linha sem o \r\n final; -1 se a conexão fechar antes
+int reader_line(http_reader_t* r, char* line, int size) {
+    while (1) {
+        char* nl = memchr(r->buf + r->start, '\n', r->end - r->start);
+        if (nl) {
+            int len = nl - (r->buf + r->start);
+            int consumed = len + 1;
+            if (len > 0 && nl[-1] == '\r') len--;
+            if (len > size - 1) len = size - 1;
+            memcpy(line, r->buf + r->start, len);
+            line[len] = '\0';
+            r->start += consumed;
+            return len;
+        }
+        if (reader_fill(r) < 0) return -1;
+    }
+}
+
+// Até 'n' bytes do corpo; 0 quando a conexão fecha
+int reader_some(http_reader_t* r, char* out, int n) {
+    if (r->start == r->end && reader_fill(r) < 0) return 0;
+    int k = r->end - r->start;
+    if (k > n) k = n;
+    memcpy(out, r->buf + r->start, k);
+    r->start += k;
+    return k;
+}
+
+// Junta os pedaços do corpo chunked em linhas NDJSON e repassa cada linha
+// completa ao cliente assim que chega
+typedef struct {
+    flight_t* out;
+    char pending[BUFFER_SIZE + 1];
+    int len;
+    int done, success;      // resumo final {"done":true,...} do engine
+    double size_time[ROUTER_MAX_POW + 1];   // "total" de cada tam, para o roteador
+} ndjson_relay_t;
+
+void relay_line(ndjson_relay_t* relay) {
+    relay->pending[relay->len] = '\0';
+    int tam, pow = 0;
+    const char* total = strstr(relay->pending, "\"total\":");
+    if (sscanf(relay->pending, "{\"tam\":%d,", &tam) == 1 && total) {
+        while ((1 << pow) < tam) pow++;
+        if (pow <= ROUTER_MAX_POW) relay->size_time[pow] = atof(total + 8);
+    }
+    if (strncmp(relay->pending, "{\"done\":true", 12) == 0) {
+        relay->done = 1;
+        relay->success = strstr(relay->pending, "\"success\":true") != NULL;
+    }
+    relay->pending[relay->len] = '\n';
+    flight_write(relay->out, relay->pending, relay->len + 1);
+    relay->len = 0;
+}
+
+void relay_bytes(ndjson_relay_t* relay, const char* data, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        if (data[i] == '\n') {
+            relay_line(relay);
+        } else {
+            relay->pending[relay->len++] = data[i];
+            if (relay->len == BUFFER_SIZE - 1) relay_line(relay);
+        }
+    }
+}
+
+// Nova conexão TCP com o engine; -1 em falha, com a mensagem em error_buffer
+int engine_connect(engine_t* engine, char* error_buffer, int buffer_size) {
+    struct sockaddr_in server_addr;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock < 0) {
-        printf("ERRO: Falha ao criar socket para ElasticSearch\n");
-        return 0;
+        snprintf(error_buffer, buffer_size, "ERRO: Falha ao criar socket para engine");
+        return -1;
     }
     
-    // Configurar endereço do ElasticSearch
+    // Configurar endereço do engine
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(ELASTICSEARCH_PORT);
+    server_addr.sin_port = htons(engine->port);
     
-    if (inet_aton(ELASTICSEARCH_HOST, &server_addr.sin_addr) == 0) {
-        printf("ERRO: IP inválido do ElasticSearch: %s\n", ELASTICSEARCH_HOST);
+    // Converter IP direto (sem DNS)
+    if (inet_aton(engine->host, &server_addr.sin_addr) == 0) {
+        snprintf(error_buffer, buffer_size, "ERRO: IP inválido %s", engine->host);
         close(sock);
-        return 0;
+        return -1;
     }
     
-    // Conectar ao ElasticSearch
-    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        printf("AVISO: Falha ao conectar no ElasticSearch %s:%d\n", ELASTICSEARCH_HOST, ELASTICSEARCH_PORT);
-        close(sock);
-        return 0;
+    // connect não bloqueante, esperando no máximo CONNECT_TIMEOUT_MS (ou o
+    // que resta do prazo): um pod travado não segura a thread
+    long long timeout = CONNECT_TIMEOUT_MS;
+    if (call_deadline > 0 && call_deadline - get_timestamp_ms() < timeout)
+        timeout = call_deadline - get_timestamp_ms();
+    int flags = fcntl(sock, F_GETFL), connected, timed_out = 0, err = 0;
+    socklen_t err_len = sizeof(err);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    connected = connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0;
+    if (!connected && errno == EINPROGRESS) {
+        struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+        int ready = timeout > 0 ? poll(&pfd, 1, (int)timeout) : 0;
+        timed_out = ready == 0;
+        connected = ready == 1 &&
+                    getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0;
     }
+    fcntl(sock, F_SETFL, flags);
     
-    // Montar requisição HTTP POST
-    snprintf(request, sizeof(request),
-        "POST /pspd-metrics/_doc HTTP/1.1\r\n"
-        "Host: %s:%d\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %lu\r\n"
-        "Connection: close\r\n"
-        "\r\n"
-        "%s",
-        ELASTICSEARCH_HOST, ELASTICSEARCH_PORT, strlen(json_body), json_body);
-    
-    // Enviar requisição
-    if (send(sock, request, strlen(request), 0) < 0) {
-        printf("ERRO: Falha ao enviar métricas para ElasticSearch\n");
+    if (timed_out && timeout < CONNECT_TIMEOUT_MS) {
+        // Esgotou o prazo do pedido, não necessariamente o engine
+        snprintf(error_buffer, buffer_size, "ERRO: Prazo esgotado ao conectar em %s:%d", engine->host, engine->port);
+        close(sock);
+        return -1;
+    }
+    if (!connected) {
+        snprintf(error_buffer, buffer_size, "ERRO: Falha ao conectar em %s:%d", engine->host, engine->port);
         close(sock);
+        // Fora da rota automática até a próxima sondagem bem-sucedida
+        pthread_mutex_lock(&engine->mutex);
+        engine->healthy = 0;
+        pthread_mutex_unlock(&engine->mutex);
+        return -1;
+    }
+    
+    pthread_mutex_lock(&engine->mutex);
+    engine->opened++;
+    pthread_mutex_unlock(&engine->mutex);
+    return sock;
+}
+
+// Conexão ociosa ainda utilizável: sem EOF nem dados pendentes do engine
+int pooled_alive(int fd) {
+    char c;
+    ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// Pega a conexão ociosa mais recente do pool (-1 se não houver), fechando
+// as que passaram do tempo de ociosidade ou foram fechadas pelo engine
+int pool_acquire(engine_t* engine) {
+    long long now = get_timestamp_ms();
+    int fd = -1, k, kept = 0;
+    
+    pthread_mutex_lock(&engine->mutex);
+    for (k = 0; k < engine->nidle; k++) {
+        if (now - engine->idle[k].last_used > POOL_IDLE_TIMEOUT_MS)
+            close(engine->idle[k].fd);
+        else
+            engine->idle[kept++] = engine->idle[k];
+    }
+    engine->nidle = kept;
+    while (engine->nidle > 0 && fd < 0) {
+        fd = engine->idle[--engine->nidle].fd;
+        if (!pooled_alive(fd)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) engine->reused++;
+    pthread_mutex_unlock(&engine->mutex);
+    return fd;
+}
+
+// Devolve a conexão ao pool, ou fecha se o pool estiver cheio
+void pool_release(engine_t* engine, int fd) {
+    pthread_mutex_lock(&engine->mutex);
+    if (engine->nidle < POOL_MAX_IDLE) {
+        engine->idle[engine->nidle].fd = fd;
+        engine->idle[engine->nidle].last_used = get_timestamp_ms();
+        engine->nidle++;
+        fd = -1;
+    }
+    pthread_mutex_unlock(&engine->mutex);
+    if (fd >= 0) close(fd);
+}
+
+// Resultado da leitura de uma resposta do engine
+#define RESP_OK 1           // resposta completa lida
+#define RESP_FAILED 0       // erro depois de já ter repassado algo
+#define RESP_STALE -1       // conexão morreu antes do primeiro byte
+#define RESP_TIMEOUT -2     // engine não respondeu em IO_TIMEOUT_MS
+
+// Lê e repassa uma resposta do engine. O engine OpenMP responde com
+// stream=ndjson em chunks, um resultado por tamanho, que são repassados
+// ao cliente conforme chegam; engines que ignoram o parâmetro (Spark)
+// respondem com um JSON único, delimitado por Content-Length ou pelo fim
+// da conexão. *reusable indica se a conexão pode voltar ao pool.
+int read_engine_response(int sock, flight_t* out, int* http_status, int* reusable,
+                         double* size_time, char* error_buffer, int buffer_size) {
+    char line[BUFFER_SIZE];
+    char body[BUFFER_SIZE];
+    int chunked = 0, keep_alive = 0, n, result = RESP_OK;
+    long content_length = -1, received = 0;
+    
+    *http_status = 0;
+    *reusable = 0;
+    http_reader_t* reader = calloc(1, sizeof(http_reader_t));
+    ndjson_relay_t* relay = calloc(1, sizeof(ndjson_relay_t));
+    if (!reader || !relay) {
+        snprintf(error_buffer, buffer_size, "ERRO: Falta de memória");
+        free(reader);
+        free(relay);
+        return RESP_FAILED;
+    }
+    reader->sock = sock;
+    relay->out = out;
+    
+    // Linha de status e cabeçalhos
+    if (reader_line(reader, line, sizeof(line)) < 0) {
+        snprintf(error_buffer, buffer_size, "ERRO: Nenhuma resposta do engine");
+        result = RESP_STALE;
+        goto done;
+    }
+    if (sscanf(line, "HTTP/%*s %d", http_status) != 1) {
+        snprintf(error_buffer, buffer_size, "ERRO: Resposta inválida do engine");
+        result = RESP_FAILED;
+        goto done;
+    }
+    keep_alive = strncmp(line, "HTTP/1.1", 8) == 0;
+    while ((n = reader_line(reader, line, sizeof(line))) > 0) {
+        if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line + 18, "chunked"))
+            chunked = 1;
+        else if (strncasecmp(line, "Content-Length:", 15) == 0)
+            content_length = atol(line + 15);
+        else if (strncasecmp(line, "Connection:", 11) == 0)
+            keep_alive = strstr(line + 11, "close") == NULL;
+    }
+    if (n < 0) {
+        snprintf(error_buffer, buffer_size, "ERRO: Resposta inválida do engine");
+        result = RESP_FAILED;
+        goto done;
+    }
+    
+    if (chunked) {
+        // Cada chunk: tamanho em hexa, dados, \r\n; o chunk vazio encerra,
+        // seguido dos trailers (nenhum) e da linha vazia
+        int complete = 0;
+        while (reader_line(reader, line, sizeof(line)) >= 0) {
+            long size = strtol(line, NULL, 16);
+            if (size <= 0) {
+                complete = reader_line(reader, line, sizeof(line)) == 0;
+                break;
+            }
+            while (size > 0 && (n = reader_some(reader, body, size < (long)sizeof(body) ? size : (long)sizeof(body))) > 0) {
+                relay_bytes(relay, body, n);
+                size -= n;
+            }
+            if (size > 0 || reader_line(reader, line, sizeof(line)) < 0) break;
+        }
+        if (relay->len > 0) relay_line(relay);
+        if (!relay->done) {
+            snprintf(error_buffer, buffer_size, "ERRO: Stream do engine interrompido");
+            result = RESP_FAILED;
+        } else if (!relay->success) {
+            snprintf(error_buffer, buffer_size, "ERRO: Engine reportou falha");
+            result = RESP_FAILED;
+        }
+        *reusable = keep_alive && complete;
+        memcpy(size_time, relay->size_time, sizeof(relay->size_time));
+    } else {
+        // Corpo único: até Content-Length ou até o engine fechar a conexão
+        while ((content_length < 0 || received < content_length) &&
+               (n = reader_some(reader, body, content_length < 0 || content_length - received > (long)sizeof(body)
+                                                  ? (long)sizeof(body) : content_length - received)) > 0) {
+            flight_write(out, body, n);
+            received += n;
+        }
+        flight_write(out, "\n", 1);
+        if (received == 0 || (content_length >= 0 && received < content_length)) {
+            snprintf(error_buffer, buffer_size, "ERRO: Resposta incompleta do engine");
+            result = RESP_FAILED;
+        }
+        *reusable = keep_alive && content_length >= 0 && received == content_length;
+    }
+    if (result == RESP_OK && (*http_status < 200 || *http_status > 299)) {
+        snprintf(error_buffer, buffer_size, "ERRO: Engine respondeu HTTP %d", *http_status);
+        result = RESP_FAILED;
+    }
+    // Bytes além da resposta indicam uma conexão fora de sincronia
+    if (reader->start != reader->end) *reusable = 0;
+    
+done:
+    free(reader);
+    free(relay);
+    return result;
+}
+
+// Conexão TCP com o ElasticSearch (aceita nome ou IP); -1 em falha.
+// Os timeouts impedem que um ElasticSearch travado prenda o shipper.
+int elasticsearch_connect(void) {
+    struct addrinfo hints, *res, *ai;
+    struct timeval timeout = { METRICS_IO_TIMEOUT_S, 0 };
+    char port[16];
+    int sock = -1;
+    
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%d", elasticsearch_port);
+    if (getaddrinfo(elasticsearch_host, port, &hints, &res) != 0) {
+        printf("ERRO: Endereço inválido do ElasticSearch: %s\n", elasticsearch_host);
+        return -1;
+    }
+    for (ai = res; ai && sock < 0; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0) continue;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (connect(sock, ai->ai_addr, ai->ai_addrlen) < 0) {
+            close(sock);
+            sock = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (sock < 0)
+        printf("AVISO: Falha ao conectar no ElasticSearch %s:%d\n", elasticsearch_host, elasticsearch_port);
+    return sock;
+}
+
+// POST /<index>/_bulk pela conexão keep-alive *sock; lê a resposta inteira
+// para deixar a conexão pronta para o próximo lote. Retorna o status HTTP
+// (0 se a conexão falhou, e nesse caso ela é fechada).
+int elasticsearch_post_bulk(int* sock, const char* body, size_t len) {
+    char headers[512];
+    char line[BUFFER_SIZE];
+    int status = 0, keep_alive = 1, n;
+    long content_length = -1;
+    
+    if (*sock < 0 && (*sock = elasticsearch_connect()) < 0)
         return 0;
+    
+    n = snprintf(headers, sizeof(headers),
+        "POST /%s/_bulk HTTP/1.1\r\n"
+        "Host: %s:%d\r\n"
+        "Content-Type: application/x-ndjson\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n",
+        elasticsearch_index, elasticsearch_host, elasticsearch_port, len);
+    send_all(*sock, headers, n);
+    send_all(*sock, body, len);
+    
+    http_reader_t* reader = calloc(1, sizeof(http_reader_t));
+    if (!reader) goto fail;
+    reader->sock = *sock;
+    if (reader_line(reader, line, sizeof(line)) < 0 ||
+        sscanf(line, "HTTP/%*s %d", &status) != 1)
+        goto fail;
+    while ((n = reader_line(reader, line, sizeof(line))) > 0) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+            content_length = atol(line + 15);
+        else if (strncasecmp(line, "Connection:", 11) == 0)
+            keep_alive = strstr(line + 11, "close") == NULL;
+    }
+    if (n < 0 || content_length < 0) goto fail;
+    
+    // Descarta o corpo (o resumo por documento do _bulk)
+    while (content_length > 0 &&
+           (n = reader_some(reader, line, content_length < (long)sizeof(line) ? content_length : (long)sizeof(line))) > 0)
+        content_length -= n;
+    if (content_length > 0) goto fail;
+    
+    free(reader);
+    if (!keep_alive) {
+        close(*sock);
+        *sock = -1;
+    }
+    return status;
+    
+fail:
+    free(reader);
+    close(*sock);
+    *sock = -1;
+    return 0;
+}
+
+// Thread do shipper: junta documentos da fila em lotes _bulk e os envia
+// quando o lote enche ou quando o documento mais antigo espera
+// METRICS_FLUSH_MS. Um lote que falha é tentado mais uma vez numa conexão
+// nova e depois descartado (contado em failed).
+void* metrics_shipper(void* arg) {
+    (void)arg;
+    size_t cap = (size_t)METRICS_BATCH_MAX * (METRICS_DOC_SIZE + 32);
+    char* body = malloc(cap);
+    char doc[METRICS_DOC_SIZE];
+    size_t len = 0;
+    int count = 0, sock = -1;
+    long long first_at = 0;
+    
+    if (!body) {
+        perror("Erro ao alocar lote de métricas");
+        return NULL;
+    }
+    
+    while (1) {
+        while (count < METRICS_BATCH_MAX && metrics_dequeue(doc, sizeof(doc))) {
+            if (count == 0) first_at = get_timestamp_ms();
+            len += snprintf(body + len, cap - len, "{\"index\":{}}\n%s\n", doc);
+            count++;
+        }
+        
+        if (count == 0 || (count < METRICS_BATCH_MAX && get_timestamp_ms() - first_at < METRICS_FLUSH_MS)) {
+            struct timespec pausa = { 0, METRICS_IDLE_SLEEP_MS * 1000000L };
+            nanosleep(&pausa, NULL);
+            continue;
+        }
+        
+        int status = elasticsearch_post_bulk(&sock, body, len);
+        if (status == 0)
+            status = elasticsearch_post_bulk(&sock, body, len);
+        
+        atomic_fetch_add(&metrics_ring.batches, 1);
+        if (status >= 200 && status <= 299) {
+            atomic_fetch_add(&metrics_ring.sent, count);
+            printf("Métricas: lote de %d enviado (enviadas=%lu, falhas=%lu, descartadas=%lu)\n", count,
+                   atomic_load(&metrics_ring.sent), atomic_load(&metrics_ring.failed),
+                   atomic_load(&metrics_ring.dropped));
+        } else {
+            atomic_fetch_add(&metrics_ring.failed, count);
+            printf("AVISO: Lote de %d métricas não enviado ao ElasticSearch (HTTP %d, falhas=%lu, descartadas=%lu)\n",
+                   count, status, atomic_load(&metrics_ring.failed), atomic_load(&metrics_ring.dropped));
+        }
+        len = 0;
+        count = 0;
     }
+    return NULL;
+}
+
+// Prazo da thread esgotado
+int deadline_passed(void) {
+    return call_deadline > 0 && get_timestamp_ms() >= call_deadline;
+}
+
+// Fazer requisição HTTP para engine por uma conexão keep-alive do pool.
+// Se uma conexão reaproveitada morrer antes de responder (o engine a
+// fechou enquanto estava ociosa), a requisição é refeita uma vez numa
+// conexão nova. Em caso de falha, a mensagem de erro fica em error_buffer.
+int call_engine_http(engine_t* engine, const char* path, int powmin, int powmax,
+                     flight_t* out, double* size_time, char* error_buffer, int buffer_size) {
+    char request[512];
+    int attempt, status, reusable, result = RESP_FAILED;
+    
+    // Montar requisição HTTP GET
+    snprintf(request, sizeof(request),
+            "GET %s?powmin=%d&powmax=%d&stream=ndjson HTTP/1.1\r\n"
+            "Host: %s:%d\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n",
+            path, powmin, powmax, engine->host, engine->port);
     
-    // Receber resposta (opcional)
-    int bytes_received = recv(sock, response, sizeof(response) - 1, 0);
-    if (bytes_received > 0) {
-        response[bytes_received] = '\0';
-        // Verificar se foi sucesso (status 200 ou 201)
-        if (strstr(response, "HTTP/1.1 20") != NULL) {
-            printf("Métricas enviadas para ElasticSearch com sucesso\n");
+    for (attempt = 0; attempt < 2; attempt++) {
+        int pooled = 1;
+        int sock = attempt == 0 ? pool_acquire(engine) : -1;
+        if (sock < 0) {
+            pooled = 0;
+            sock = engine_connect(engine, error_buffer, buffer_size);
+            if (sock < 0) return 0;
+        }
+        
+        if (send(sock, request, strlen(request), MSG_NOSIGNAL) < 0) {
+            snprintf(error_buffer, buffer_size, "ERRO: Falha ao enviar requisição para engine");
+            close(sock);
+            if (pooled) continue;
+            return 0;
+        }
+        
+        result = read_engine_response(sock, out, &status, &reusable,
+                                      size_time, error_buffer, buffer_size);
+        if (reusable)
+            pool_release(engine, sock);
+        else
+            close(sock);
+        
+        if (result == RESP_STALE && pooled && !deadline_passed()) {
+            printf("Conexão ociosa com %s estava fechada; reconectando\n", engine->name);
+            continue;
         }
+        break;
+    }
+    if (result != RESP_OK && deadline_passed()) {
+        metrics_add(prom.deadline_exceeded, 1);
+        snprintf(error_buffer, buffer_size, "ERRO: Prazo esgotado esperando o engine %s", engine->name);
     }
+    return result == RESP_OK;
+}
+
+// Lê uma resposta com Content-Length para '*body' (malloc, terminado em
+// '\0'); retorna o status HTTP, 0 em falha, RESP_STALE se a conexão
+// morreu antes do primeiro byte ou RESP_TIMEOUT se o engine parou de
+// responder
+int read_small_response(int sock, char** body, int* reusable) {
+    http_reader_t* reader = calloc(1, sizeof(http_reader_t));
+    char line[BUFFER_SIZE];
+    long content_length = -1, received = 0;
+    int status = 0, keep_alive, n;
     
-    close(sock);
-    return 1;
+    *body = NULL;
+    *reusable = 0;
+    if (!reader) return 0;
+    reader->sock = sock;
+    reader->io_timeout = IO_TIMEOUT_MS;
+    if (reader_line(reader, line, sizeof(line)) < 0) {
+        status = reader->timed_out ? RESP_TIMEOUT : RESP_STALE;
+        free(reader);
+        return status;
+    }
+    if (sscanf(line, "HTTP/%*s %d", &status) != 1) {
+        free(reader);
+        return 0;
+    }
+    keep_alive = strncmp(line, "HTTP/1.1", 8) == 0;
+    while ((n = reader_line(reader, line, sizeof(line))) > 0) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+            content_length = atol(line + 15);
+        else if (strncasecmp(line, "Connection:", 11) == 0)
+            keep_alive = strstr(line + 11, "close") == NULL;
+    }
+    if (n < 0 || content_length < 0 || content_length > JOB_BODY_MAX ||
+        !(*body = malloc(content_length + 1))) {
+        status = reader->timed_out ? RESP_TIMEOUT : 0;
+        free(reader);
+        return status;
+    }
+    while (received < content_length &&
+           (n = reader_some(reader, *body + received, content_length - received)) > 0)
+        received += n;
+    (*body)[received] = '\0';
+    *reusable = keep_alive && received == content_length && reader->start == reader->end;
+    if (received < content_length) {
+        status = reader->timed_out ? RESP_TIMEOUT : 0;
+        free(*body);
+        *body = NULL;
+    }
+    free(reader);
+    return status;
 }
 
-// Fazer requisição HTTP para engine
-int call_engine_http(const char* service_host, int service_port, const char* path, 
-                     int powmin, int powmax, char* response_buffer, int buffer_size) {
-    int sock;
-    struct sockaddr_in server_addr;
+// Requisição curta à API de jobs do engine. Retorna o status HTTP (0 em
+// falha) e o corpo em '*body', que o chamador libera.
+// Um job só existe no pod que aceitou o POST, e o Service balanceia cada
+// conexão nova entre as réplicas: as chamadas de um job passam todas pela
+// conexão '*pinned', que fica fora do pool até o job acabar. Com *pinned
+// < 0 (o POST) a conexão vem do pool, com a mesma nova tentativa de
+// call_engine_http, e fica em *pinned; se ela cair depois, *pinned volta
+// a -1 e não há nova tentativa, que poderia cair em outro pod.
+int engine_request(engine_t* engine, int* pinned, const char* method, const char* path,
+                   char** body, char* error_buffer, int buffer_size) {
     char request[512];
-    char response[4096];
-    int bytes_received;
+    int attempt, status = 0, reusable;
     
-    // Criar socket
-    sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        snprintf(response_buffer, buffer_size, "ERRO: Falha ao criar socket para engine");
+    *body = NULL;
+    snprintf(request, sizeof(request),
+            "%s %s HTTP/1.1\r\n"
+            "Host: %s:%d\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n",
+            method, path, engine->host, engine->port);
+    
+    for (attempt = 0; attempt < 2; attempt++) {
+        int pooled = 1, fixed = *pinned >= 0;
+        int sock = fixed ? *pinned : attempt == 0 ? pool_acquire(engine) : -1;
+        *pinned = -1;
+        if (sock < 0) {
+            pooled = 0;
+            sock = engine_connect(engine, error_buffer, buffer_size);
+            if (sock < 0) return 0;
+        }
+        if (send(sock, request, strlen(request), MSG_NOSIGNAL) < 0) {
+            close(sock);
+            if (pooled && !fixed) continue;
+            snprintf(error_buffer, buffer_size, "ERRO: Falha ao enviar requisição para engine");
+            return 0;
+        }
+        status = read_small_response(sock, body, &reusable);
+        if (reusable)
+            *pinned = sock;
+        else
+            close(sock);
+        if (status == RESP_STALE && pooled && !fixed) continue;
+        break;
+    }
+    if (status == RESP_TIMEOUT && !deadline_passed()) {
+        // Pod travado: fora da rota (e o scatter passa o tam para outra
+        // réplica) até a próxima sondagem bem-sucedida
+        printf("AVISO: Engine %s sem resposta em %d ms para %s %s\n", engine->name, IO_TIMEOUT_MS, method, path);
+        pthread_mutex_lock(&engine->mutex);
+        engine->healthy = 0;
+        pthread_mutex_unlock(&engine->mutex);
+        snprintf(error_buffer, buffer_size, "ERRO: Engine %s sem resposta em %s %s", engine->name, method, path);
         return 0;
     }
+    if (status <= 0) {
+        status = 0;
+        snprintf(error_buffer, buffer_size, "ERRO: Resposta inválida do engine em %s %s", method, path);
+    }
+    return status;
+}
+
+// O cliente do líder foi embora e nenhum seguidor espera o resultado.
+// Nesse caso o pedido sai da tabela, para que um pedido igual que chegue
+// agora não se junte a um job que vai ser cancelado. EOF na leitura não
+// basta: um cliente que só fechou o lado de escrita (shutdown(SHUT_WR))
+// ainda lê a resposta. Conta só um envio que falhou ou um erro pendente
+// no socket (RST recebido).
+int flight_abandoned(flight_t* flight) {
+    int alone, err = 0;
+    socklen_t err_len = sizeof(err);
+    if (flight->parent)
+        return flight_abandoned(flight->parent);
+    if (!atomic_load(&flight->leader_gone) &&
+        (getsockopt(flight->leader_socket, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err == 0))
+        return 0;
+    atomic_store(&flight->leader_gone, 1);
     
-    // Configurar endereço do engine
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(service_port);
+    pthread_mutex_lock(&flights_mutex);
+    pthread_mutex_lock(&flight->mutex);
+    alone = flight->refs <= 1;
+    pthread_mutex_unlock(&flight->mutex);
+    if (alone) {
+        flight_t** p;
+        for (p = &flights; *p; p = &(*p)->next) {
+            if (*p == flight) {
+                *p = flight->next;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&flights_mutex);
+    return alone;
+}
+
+// DELETE /jobs/{id} com prazo próprio: o do pedido pode já ter acabado.
+// Sem a conexão do job não há como chegar ao pod que o executa.
+void cancel_engine_job(engine_t* engine, int* pinned, const char* path) {
+    char error[256], *body;
+    long long saved = call_deadline;
+    if (*pinned < 0) {
+        printf("AVISO: Conexão do job %s perdida; não foi possível cancelá-lo\n", path);
+        return;
+    }
+    call_deadline = get_timestamp_ms() + CANCEL_TIMEOUT_MS;
+    engine_request(engine, pinned, "DELETE", path, &body, error, sizeof(error));
+    free(body);
+    call_deadline = saved;
+}
+
+// Executa o pedido como job assíncrono do engine: POST /jobs devolve o id
+// na hora e GET /jobs/{id} é consultado com intervalo crescente (até
+// JOB_POLL_MS, para que pedidos curtos não paguem a espera), repassando os
+// resultados novos (uma linha por tam, como no stream NDJSON). Se o
+// cliente desconectar, o prazo acabar ou a chamada perder um hedge, DELETE
+// /jobs/{id} para o cálculo no engine em vez de deixar os núcleos
+// ocupados com um resultado que ninguém vai ler.
+int call_engine_job(engine_t* engine, int powmin, int powmax, flight_t* out,
+                    double* size_time, char* error_buffer, int buffer_size) {
+    char path[128];
+    char* body;
+    int status, relayed = 0, result = 0, delay = JOB_POLL_MIN_MS, sock = -1;
+    long long id = 0;
+    ndjson_relay_t* relay = calloc(1, sizeof(ndjson_relay_t));
     
-    // Converter IP direto (sem DNS)
-    if (inet_aton(service_host, &server_addr.sin_addr) == 0) {
-        snprintf(response_buffer, buffer_size, "ERRO: IP inválido %s", service_host);
-        close(sock);
+    if (!relay) {
+        snprintf(error_buffer, buffer_size, "ERRO: Falta de memória");
         return 0;
     }
+    relay->out = out;
     
-    // Conectar ao engine
-    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        snprintf(response_buffer, buffer_size, "ERRO: Falha ao conectar em %s:%d", service_host, service_port);
-        close(sock);
+    snprintf(path, sizeof(path), "/jobs?powmin=%d&powmax=%d", powmin, powmax);
+    status = engine_request(engine, &sock, "POST", path, &body, error_buffer, buffer_size);
+    if (status == 202 && body) {
+        const char* p = strstr(body, "\"id\":");
+        if (p) id = atoll(p + 5);
+    }
+    free(body);
+    if (id <= 0 || sock < 0) {
+        if (status != 0)
+            snprintf(error_buffer, buffer_size, "ERRO: Engine recusou o job (HTTP %d)", status);
+        if (sock >= 0) pool_release(engine, sock);
+        free(relay);
         return 0;
     }
+    printf("Job %lld criado no engine %s\n", id, engine->name);
+    snprintf(path, sizeof(path), "/jobs/%lld", id);
+    
+    while (!relay->done) {
+        usleep(delay * 1000);
+        if (delay < JOB_POLL_MS) delay = delay * 2 < JOB_POLL_MS ? delay * 2 : JOB_POLL_MS;
+        
+        if (atomic_load(&out->cancel)) {
+            cancel_engine_job(engine, &sock, path);
+            snprintf(error_buffer, buffer_size, "ERRO: Job %lld cancelado; a outra chamada terminou antes", id);
+            break;
+        }
+        if (flight_abandoned(out)) {
+            cancel_engine_job(engine, &sock, path);
+            printf("Cliente desconectou: job %lld cancelado no engine %s\n", id, engine->name);
+            snprintf(error_buffer, buffer_size, "ERRO: Cliente desconectou; job %lld cancelado", id);
+            break;
+        }
+        if (deadline_passed()) {
+            cancel_engine_job(engine, &sock, path);
+            metrics_add(prom.deadline_exceeded, 1);
+            printf("Prazo esgotado: job %lld cancelado no engine %s\n", id, engine->name);
+            snprintf(error_buffer, buffer_size, "ERRO: Prazo esgotado; job %lld cancelado", id);
+            break;
+        }
+        
+        if (sock < 0) {
+            snprintf(error_buffer, buffer_size, "ERRO: Conexão com o pod do job %lld perdida", id);
+            break;
+        }
+        status = engine_request(engine, &sock, "GET", path, &body, error_buffer, buffer_size);
+        if (status != 200 || !body) {
+            if (deadline_passed()) {
+                // A consulta foi cortada pelo prazo; o job ainda roda
+                cancel_engine_job(engine, &sock, path);
+                metrics_add(prom.deadline_exceeded, 1);
+                snprintf(error_buffer, buffer_size, "ERRO: Prazo esgotado; job %lld cancelado", id);
+            } else if (status != 0) {
+                snprintf(error_buffer, buffer_size, "ERRO: Engine respondeu HTTP %d para o job %lld", status, id);
+            }
+            free(body);
+            break;
+        }
+        
+        // Resposta de outro job (outro pod, ou um id reaproveitado) não
+        // pode ser repassada como se fosse deste pedido
+        const char* field_min = strstr(body, "\"powmin\":");
+        const char* field_max = strstr(body, "\"powmax\":");
+        if (strncmp(body, "{\"id\":", 6) != 0 || atoll(body + 6) != id || !field_min || !field_max ||
+            atoi(field_min + 9) != powmin || atoi(field_max + 9) != powmax) {
+            snprintf(error_buffer, buffer_size, "ERRO: Engine devolveu outro job para /jobs/%lld", id);
+            free(body);
+            break;
+        }
+        
+        // Linhas de resultado ({"tam":..} ou {"log":..}) e o resumo final
+        // {"done":true,...}; só as que ainda não foram repassadas
+        char* line = body;
+        int index = 0;
+        while (line && *line) {
+            char* nl = strchr(line, '\n');
+            int len = nl ? nl - line : (int)strlen(line);
+            if (len > 0 && line[len - 1] == ',') len--;
+            int is_result = strncmp(line, "{\"tam\":", 7) == 0 || strncmp(line, "{\"log\":", 7) == 0;
+            int is_done = strncmp(line, "{\"done\":true", 12) == 0;
+            if ((is_result && index++ >= relayed) || is_done) {
+                if (len > BUFFER_SIZE - 1) len = BUFFER_SIZE - 1;
+                memcpy(relay->pending, line, len);
+                relay->len = len;
+                relay_line(relay);
+                if (is_result) relayed++;
+            }
+            line = nl ? nl + 1 : NULL;
+        }
+        free(body);
+    }
+    
+    if (relay->done) {
+        result = relay->success;
+        if (!result)
+            snprintf(error_buffer, buffer_size, "ERRO: Engine reportou falha");
+    }
+    // Terminado o job, a conexão volta a ser uma como as outras
+    if (sock >= 0) pool_release(engine, sock);
+    memcpy(size_time, relay->size_time, sizeof(relay->size_time));
+    free(relay);
+    return result;
+}
+
+// Atualizações de célula de um tamanho: 4*(tam-3) gerações de tam² células
+double size_cost(int pow) {
+    double tam = (double)(1 << pow);
+    return 4.0 * (tam - 3.0) * tam * tam;
+}
+
+// Tempo estimado do intervalo no engine: a média do tamanho quando já há
+// amostra, senão o custo do tamanho vezes a taxa média do engine. Com o
+// intervalo dividido entre as réplicas, o tempo é o do maior tamanho ou o
+// da soma repartida, o que for maior.
+double estimate_locked(const engine_t* engine, int powmin, int powmax) {
+    double sum = 0.0, largest = 0.0;
+    int pow, width = atomic_load(&scatter_width);
+    for (pow = powmin; pow <= powmax; pow++) {
+        double t = engine->ewma_size[pow] > 0.0 ? engine->ewma_size[pow]
+                                                : engine->ewma_rate * size_cost(pow);
+        sum += t;
+        if (t > largest) largest = t;
+    }
+    if (engine->scatter && width >= 2 && powmax > powmin)
+        sum = sum / width > largest ? sum / width : largest;
+    return engine->ewma_overhead + sum;
+}
+
+double ewma(double media, double amostra) {
+    return media + ROUTER_EWMA_ALPHA * (amostra - media);
+}
+
+// Escolhe o engine com menor tempo esperado de conclusão (trabalho em
+// andamento + estimativa desta requisição) entre os saudáveis; se nenhum
+// estiver saudável, entre todos. A decisão vai em JSON para as métricas.
+engine_t* route_request(int powmin, int powmax, double* estimate, char* decision, size_t size) {
+    double ect[NUM_ENGINES], est[NUM_ENGINES];
+    int healthy[NUM_ENGINES], outstanding[NUM_ENGINES];
+    int k, best = -1, any_healthy = 0;
+    size_t pos;
+    
+    for (k = 0; k < NUM_ENGINES; k++) {
+        pthread_mutex_lock(&engines[k].mutex);
+        est[k] = estimate_locked(&engines[k], powmin, powmax);
+        ect[k] = engines[k].outstanding_time + est[k];
+        healthy[k] = engines[k].healthy;
+        outstanding[k] = engines[k].outstanding;
+        pthread_mutex_unlock(&engines[k].mutex);
+        any_healthy |= healthy[k];
+    }
+    for (k = 0; k < NUM_ENGINES; k++)
+        if ((healthy[k] || !any_healthy) && (best < 0 || ect[k] < ect[best]))
+            best = k;
+    
+    pos = snprintf(decision, size, "{\"policy\":\"ect\",\"chosen\":\"%s\",\"candidates\":{", engines[best].name);
+    for (k = 0; k < NUM_ENGINES && pos < size; k++)
+        pos += snprintf(decision + pos, size - pos,
+                        "%s\"%s\":{\"healthy\":%s,\"outstanding\":%d,\"estimate\":%.6f,\"ect\":%.6f}",
+                        k ? "," : "", engines[k].name, healthy[k] ? "true" : "false",
+                        outstanding[k], est[k], ect[k]);
+    if (pos < size) snprintf(decision + pos, size - pos, "}}");
+    
+    *estimate = est[best];
+    return &engines[best];
+}
+
+void router_begin(engine_t* engine, double estimate) {
+    pthread_mutex_lock(&engine->mutex);
+    engine->outstanding++;
+    engine->outstanding_time += estimate;
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+// Fim da requisição: libera a estimativa e, com sucesso, atualiza as
+// médias. Com os tempos por tamanho do stream NDJSON, cada tamanho tem sua
+// amostra e o restante do tempo vira custo fixo; com uma resposta única,
+// o tempo total (menos o custo fixo) dá a amostra da taxa do engine.
+void router_end(engine_t* engine, double estimate, int powmin, int powmax,
+                double elapsed, const double* size_time, int success) {
+    double sizes = 0.0, cost = 0.0;
+    int pow, have_sizes = 1;
+    
+    for (pow = powmin; pow <= powmax; pow++) {
+        sizes += size_time[pow];
+        cost += size_cost(pow);
+        if (size_time[pow] <= 0.0) have_sizes = 0;
+    }
+    
+    pthread_mutex_lock(&engine->mutex);
+    engine->outstanding--;
+    engine->outstanding_time -= estimate;
+    if (engine->outstanding == 0 || engine->outstanding_time < 0.0)
+        engine->outstanding_time = 0.0;
+    if (success) {
+        engine->healthy = 1;
+        if (powmin == powmax)
+            engine->latency[powmax][engine->latency_count[powmax]++ % HEDGE_SAMPLES] = elapsed;
+        if (have_sizes) {
+            for (pow = powmin; pow <= powmax; pow++) {
+                engine->ewma_size[pow] = engine->ewma_size[pow] > 0.0
+                    ? ewma(engine->ewma_size[pow], size_time[pow]) : size_time[pow];
+            }
+            engine->ewma_rate = ewma(engine->ewma_rate, size_time[powmax] / size_cost(powmax));
+            engine->ewma_overhead = ewma(engine->ewma_overhead, elapsed > sizes ? elapsed - sizes : 0.0);
+        } else {
+            double work = elapsed - engine->ewma_overhead;
+            if (work > 0.0)
+                engine->ewma_rate = ewma(engine->ewma_rate, work / cost);
+            if (powmin == powmax && work > 0.0)
+                engine->ewma_size[powmax] = engine->ewma_size[powmax] > 0.0
+                    ? ewma(engine->ewma_size[powmax], work) : work;
+        }
+    }
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+int compare_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// p95 das últimas chamadas de um tam só no engine; 0 sem amostras bastantes
+double latency_p95_locked(const engine_t* engine, int pow) {
+    float sorted[HEDGE_SAMPLES];
+    int n = engine->latency_count[pow] < HEDGE_SAMPLES ? engine->latency_count[pow] : HEDGE_SAMPLES;
+    if (n < HEDGE_MIN_SAMPLES) return 0.0;
+    memcpy(sorted, engine->latency[pow], n * sizeof(float));
+    qsort(sorted, n, sizeof(float), compare_float);
+    return sorted[(int)(0.95 * (n - 1) + 0.5)];
+}
+
+// Scatter-gather: cada tam do intervalo vira um sub-pedido powmin=powmax,
+// distribuído entre as réplicas saudáveis do engine OpenMP. Há um worker
+// por réplica; cada um pega o maior tam ainda pendente quando fica livre
+// (maior primeiro), então o tempo total tende ao do maior tam. A saída de
+// cada sub-pedido fica guardada e é repassada ao cliente em ordem de tam,
+// assim que todos os menores chegaram.
+//
+// Hedging: um worker sem tam pendente fica de olho nos que estão rodando
+// em outras réplicas. Passado o p95 da réplica para aquele tam, ele
+// dispara uma duplicata na sua; a primeira que terminar vale e a outra é
+// cancelada (DELETE /jobs/{id}).
+enum { PART_PENDING = 0, PART_RUNNING, PART_OK, PART_FAILED };
+
+typedef struct {
+    int state;
+    int attempts;
+    int running;                // chamadas em andamento: original e duplicata
+    int hedged;                 // a duplicata desta tentativa já saiu
+    flight_t out[2];            // saída guardada: [0] original, [1] duplicata
+    engine_t* owner[2];
+    int winner;                 // índice de 'out' que terminou primeiro
+    long long started;          // início da chamada original (ms)
+    double trigger;             // p95 da réplica original (s); 0 = sem hedge
+    double size_time;
+} scatter_part_t;
+
+typedef struct {
+    int powmin, powmax;
+    scatter_part_t part[ROUTER_MAX_POW + 1];
+    long long deadline;         // call_deadline do pedido, herdado pelos workers
+    int workers;                // workers ainda rodando
+    int abort;                  // um tam falhou: não começar outros
+    int hedges, hedge_wins;
+    char error[1024];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} scatter_t;
+
+typedef struct {
+    scatter_t* sc;
+    engine_t* replica;
+} scatter_worker_t;
+
+// Próxima chamada do worker, com sc->mutex: o maior tam pendente ou, sem
+// nenhum, a duplicata de um tam que passou do p95 em outra réplica.
+// Retorna o tam e a posição em 'out' (0/1); -1 quando não há mais nada a
+// fazer, e 0 em '*wait_ms' quando é só esperar a próxima mudança.
+int scatter_next(scatter_t* sc, engine_t* replica, int* slot, long long* wait_ms) {
+    long long now = get_timestamp_ms(), soonest = -1;
+    int pow, active = 0;
+    
+    for (pow = sc->powmax; pow >= sc->powmin && !sc->abort; pow--) {
+        scatter_part_t* p = &sc->part[pow];
+        if (p->state != PART_PENDING) continue;
+        p->state = PART_RUNNING;
+        p->attempts++;
+        p->running = 1;
+        p->hedged = 0;
+        p->owner[0] = replica;
+        p->started = now;
+        pthread_mutex_lock(&replica->mutex);
+        p->trigger = latency_p95_locked(replica, pow);
+        pthread_mutex_unlock(&replica->mutex);
+        *slot = 0;
+        return pow;
+    }
+    for (pow = sc->powmax; pow >= sc->powmin; pow--) {
+        scatter_part_t* p = &sc->part[pow];
+        if (p->state != PART_RUNNING) continue;
+        active = 1;
+        if (sc->abort || p->hedged || p->owner[0] == replica || p->trigger <= 0.0) continue;
+        long long fire = p->started + (long long)(p->trigger * 1000.0);
+        if (fire <= now) {
+            p->hedged = 1;
+            p->running++;
+            p->owner[1] = replica;
+            sc->hedges++;
+            *slot = 1;
+            return pow;
+        }
+        if (soonest < 0 || fire - now < soonest) soonest = fire - now;
+    }
+    *wait_ms = active ? (soonest > 0 ? soonest : 0) : -1;
+    return -1;
+}
+
+void* scatter_worker(void* arg) {
+    scatter_worker_t* w = (scatter_worker_t*)arg;
+    scatter_t* sc = w->sc;
+    engine_t* replica = w->replica;
+    
+    call_deadline = sc->deadline;
+    pthread_mutex_lock(&sc->mutex);
+    while (1) {
+        long long wait_ms = -1;
+        int slot = 0, chosen = scatter_next(sc, replica, &slot, &wait_ms);
+        if (chosen < 0) {
+            if (wait_ms < 0) break;
+            if (wait_ms == 0) {
+                pthread_cond_wait(&sc->cond, &sc->mutex);
+            } else {
+                long long until = get_timestamp_ms() + wait_ms;
+                struct timespec ts = { until / 1000, (until % 1000) * 1000000L };
+                pthread_cond_timedwait(&sc->cond, &sc->mutex, &ts);
+            }
+            continue;
+        }
+        scatter_part_t* p = &sc->part[chosen];
+        flight_t* out = &p->out[slot];
+        out->len = 0;
+        atomic_store(&out->cancel, 0);
+        if (slot == 1)
+            printf("Hedge: tam=%d passou de %.3fs em %s; duplicata em %s\n",
+                   1 << chosen, p->trigger, p->owner[0]->name, replica->name);
+        pthread_mutex_unlock(&sc->mutex);
+        
+        double size_time[ROUTER_MAX_POW + 1] = { 0 };
+        char error[512];
+        double estimate;
+        pthread_mutex_lock(&replica->mutex);
+        estimate = estimate_locked(replica, chosen, chosen);
+        pthread_mutex_unlock(&replica->mutex);
+        router_begin(replica, estimate);
+        metrics_add(slot ? prom.hedges : prom.scatter_parts, 1);
+        atomic_fetch_add(slot ? &hedged_calls : &replica_calls, 1);
+        long long call_start = get_timestamp_ms();
+        int ok = call_engine_job(replica, chosen, chosen, out, size_time, error, sizeof(error));
+        // O perdedor cancelado não entra nas latências da réplica
+        router_end(replica, estimate, chosen, chosen,
+                   (get_timestamp_ms() - call_start) / 1000.0, size_time, ok);
+        
+        pthread_mutex_lock(&replica->mutex);
+        int replica_down = !replica->healthy;
+        pthread_mutex_unlock(&replica->mutex);
+        
+        pthread_mutex_lock(&sc->mutex);
+        p->running--;
+        if (ok && p->state == PART_RUNNING) {
+            p->state = PART_OK;
+            p->winner = slot;
+            p->size_time = size_time[chosen];
+            if (p->running > 0)
+                atomic_store(&p->out[1 - slot].cancel, 1);
+            if (slot == 1) {
+                sc->hedge_wins++;
+                metrics_add(prom.hedge_wins, 1);
+            }
+        } else if (!ok && p->state == PART_RUNNING && p->running == 0) {
+            if (replica_down && p->attempts < SCATTER_ATTEMPTS) {
+                // A réplica caiu: o tam volta para a fila de outra
+                p->state = PART_PENDING;
+            } else {
+                p->state = PART_FAILED;
+                sc->abort = 1;
+                if (!sc->error[0])
+                    snprintf(sc->error, sizeof(sc->error), "%s (tam=%d em %s)", error, 1 << chosen, replica->name);
+            }
+        }
+        // Falhou com a outra chamada ainda rodando: ela decide o tam
+        pthread_cond_broadcast(&sc->cond);
+        if (!ok && replica_down) break;
+    }
+    sc->workers--;
+    pthread_cond_broadcast(&sc->cond);
+    pthread_mutex_unlock(&sc->mutex);
+    
+    // Libera a reserva feita em scatter_reserve
+    pthread_mutex_lock(&replica->mutex);
+    replica->outstanding--;
+    pthread_mutex_unlock(&replica->mutex);
+    free(w);
+    return NULL;
+}
+
+// Repassa a saída guardada de um tam, sem o resumo {"done":...} do sub-pedido
+void scatter_forward(flight_t* out, const flight_t* part) {
+    size_t pos = 0;
+    while (pos < part->len) {
+        const char* line = part->out + pos;
+        const char* nl = memchr(line, '\n', part->len - pos);
+        size_t len = nl ? (size_t)(nl - line) + 1 : part->len - pos;
+        if (strncmp(line, "{\"done\":", 8) != 0)
+            flight_write(out, line, len);
+        pos += len;
+    }
+}
+
+// Réplicas presentes e saudáveis, cada uma reservada (outstanding++) para
+// que a sondagem não reaproveite o slot enquanto o worker o usa
+int scatter_reserve(engine_t** chosen) {
+    int k, n = 0;
+    pthread_mutex_lock(&replicas_mutex);
+    for (k = 0; k < num_replicas; k++) {
+        engine_t* replica = &replicas[k].engine;
+        pthread_mutex_lock(&replica->mutex);
+        if (replicas[k].present && replica->healthy) {
+            replica->outstanding++;
+            chosen[n++] = replica;
+        }
+        pthread_mutex_unlock(&replica->mutex);
+    }
+    pthread_mutex_unlock(&replicas_mutex);
+    return n;
+}
+
+// Executa o intervalo dividido entre as réplicas. Os resultados chegam ao
+// cliente como no stream de uma chamada só, seguidos de um resumo
+// {"done":true,...} do pedido inteiro; a distribuição e os hedges vão em
+// 'routing'.
+int call_engine_scatter(int powmin, int powmax, flight_t* out, double* size_time,
+                        char* routing, size_t routing_size, char* error_buffer, int buffer_size) {
+    engine_t* chosen[MAX_REPLICAS];
+    int k, pow, i, started = 0, success = 1;
+    long long start = get_timestamp_ms();
+    scatter_t* sc = calloc(1, sizeof(scatter_t));
+    
+    if (!sc) {
+        snprintf(error_buffer, buffer_size, "ERRO: Falta de memória");
+        return 0;
+    }
+    sc->powmin = powmin;
+    sc->powmax = powmax;
+    sc->deadline = call_deadline;
+    for (pow = powmin; pow <= powmax; pow++) {
+        for (i = 0; i < 2; i++) {
+            flight_t* f = &sc->part[pow].out[i];
+            f->leader_socket = -1;
+            f->parent = out;
+            pthread_mutex_init(&f->mutex, NULL);
+            pthread_cond_init(&f->cond, NULL);
+        }
+    }
+    pthread_mutex_init(&sc->mutex, NULL);
+    pthread_cond_init(&sc->cond, NULL);
+    
+    int n = scatter_reserve(chosen);
+    for (k = 0; k < n; k++) {
+        scatter_worker_t* w = malloc(sizeof(scatter_worker_t));
+        pthread_t thread;
+        if (w) {
+            w->sc = sc;
+            w->replica = chosen[k];
+            pthread_mutex_lock(&sc->mutex);
+            sc->workers++;
+            pthread_mutex_unlock(&sc->mutex);
+            if (pthread_create(&thread, NULL, scatter_worker, w) == 0) {
+                pthread_detach(thread);
+                started++;
+                continue;
+            }
+            pthread_mutex_lock(&sc->mutex);
+            sc->workers--;
+            pthread_mutex_unlock(&sc->mutex);
+            free(w);
+        }
+        pthread_mutex_lock(&chosen[k]->mutex);
+        chosen[k]->outstanding--;
+        pthread_mutex_unlock(&chosen[k]->mutex);
+    }
+    printf("Scatter: POWMIN=%d, POWMAX=%d dividido entre %d réplicas\n", powmin, powmax, started);
+    
+    // Repassa em ordem; um tam pendente sem workers nunca vai terminar
+    pthread_mutex_lock(&sc->mutex);
+    for (pow = powmin; pow <= powmax && success; pow++) {
+        scatter_part_t* p = &sc->part[pow];
+        while (p->state != PART_OK && p->state != PART_FAILED &&
+               !(p->state == PART_PENDING && (sc->workers == 0 || sc->abort)))
+            pthread_cond_wait(&sc->cond, &sc->mutex);
+        if (p->state != PART_OK) {
+            success = 0;
+            sc->abort = 1;
+            if (!sc->error[0])
+                snprintf(sc->error, sizeof(sc->error), "ERRO: Nenhuma réplica disponível para tam=%d", 1 << pow);
+            break;
+        }
+        pthread_mutex_unlock(&sc->mutex);
+        scatter_forward(out, &p->out[p->winner]);
+        size_time[pow] = p->size_time;
+        pthread_mutex_lock(&sc->mutex);
+    }
+    // Falhou: chamadas ainda rodando não vão mais ser usadas
+    if (!success)
+        for (pow = powmin; pow <= powmax; pow++)
+            for (i = 0; i < 2; i++)
+                atomic_store(&sc->part[pow].out[i].cancel, 1);
+    // Os workers usam 'sc' até saírem
+    while (sc->workers > 0)
+        pthread_cond_wait(&sc->cond, &sc->mutex);
+    pthread_mutex_unlock(&sc->mutex);
+    
+    char line[256];
+    int len = snprintf(line, sizeof(line),
+                       "{\"done\":true,\"success\":%s,\"engine\":\"OpenMP\",\"powmin\":%d,\"powmax\":%d,"
+                       "\"replicas\":%d,\"hedges\":%d,\"hedge_wins\":%d,\"total_time\":%.6f}\n",
+                       success ? "true" : "false", powmin, powmax, started, sc->hedges, sc->hedge_wins,
+                       (get_timestamp_ms() - start) / 1000.0);
+    flight_write(out, line, len);
+    
+    size_t pos = snprintf(routing, routing_size,
+                          "{\"policy\":\"scatter\",\"chosen\":\"openmp\",\"replicas\":%d,"
+                          "\"hedges\":%d,\"hedge_wins\":%d,\"parts\":{",
+                          started, sc->hedges, sc->hedge_wins);
+    for (pow = powmin; pow <= powmax && pos < routing_size; pow++) {
+        scatter_part_t* p = &sc->part[pow];
+        engine_t* owner = p->state == PART_OK ? p->owner[p->winner] : p->owner[0];
+        pos += snprintf(routing + pos, routing_size - pos, "%s\"%d\":\"%s%s\"",
+                        pow > powmin ? "," : "", 1 << pow, owner ? owner->name : "",
+                        p->state == PART_OK && p->winner == 1 ? " (hedge)" : "");
+    }
+    if (pos < routing_size) snprintf(routing + pos, routing_size - pos, "}}");
+    
+    if (!success)
+        snprintf(error_buffer, buffer_size, "%s", sc->error);
+    for (pow = powmin; pow <= powmax; pow++) {
+        for (i = 0; i < 2; i++) {
+            flight_t* f = &sc->part[pow].out[i];
+            free(f->out);
+            pthread_mutex_destroy(&f->mutex);
+            pthread_cond_destroy(&f->cond);
+        }
+    }
+    pthread_mutex_destroy(&sc->mutex);
+    pthread_cond_destroy(&sc->cond);
+    free(sc);
+    return success;
+}
+
+// Sonda GET /health numa conexão própria, com timeout curto
+int probe_engine(engine_t* engine) {
+    struct timeval timeout = { ROUTER_PROBE_TIMEOUT_S, 0 };
+    char error[128], line[BUFFER_SIZE], request[256];
+    int status = 0;
+    
+    int sock = engine_connect(engine, error, sizeof(error));
+    if (sock < 0) return 0;
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
     
-    // Montar requisição HTTP GET
     snprintf(request, sizeof(request),
-            "GET %s?powmin=%d&powmax=%d HTTP/1.1\r\n"
+            "GET /health HTTP/1.1\r\n"
             "Host: %s:%d\r\n"
             "Connection: close\r\n"
             "\r\n",
-            path, powmin, powmax, service_host, service_port);
-    
-    // Enviar requisição
-    if (send(sock, request, strlen(request), 0) < 0) {
-        snprintf(response_buffer, buffer_size, "ERRO: Falha ao enviar requisição para engine");
-        close(sock);
-        return 0;
+            engine->host, engine->port);
+    http_reader_t* reader = calloc(1, sizeof(http_reader_t));
+    if (reader && send(sock, request, strlen(request), MSG_NOSIGNAL) > 0) {
+        reader->sock = sock;
+        reader->io_timeout = ROUTER_PROBE_TIMEOUT_S * 1000;
+        if (reader_line(reader, line, sizeof(line)) >= 0)
+            sscanf(line, "HTTP/%*s %d", &status);
     }
-    
-    // Receber resposta
-    bytes_received = recv(sock, response, sizeof(response) - 1, 0);
+    free(reader);
     close(sock);
+    return status == 200;
+}
+
+// Resolve OPENMP_REPLICAS e atualiza a tabela de réplicas. Um IP novo
+// ocupa um slot vazio ou o de uma réplica que sumiu e não tem chamadas
+// em andamento, de modo que quem usa um slot nunca vê o host mudar.
+void replicas_refresh(void) {
+    char ips[MAX_REPLICAS][INET_ADDRSTRLEN], spec[512];
+    int n = 0, i, k;
+    char* saveptr;
     
-    if (bytes_received <= 0) {
-        snprintf(response_buffer, buffer_size, "ERRO: Nenhuma resposta do engine");
-        return 0;
+    if (!replicas_spec) return;
+    snprintf(spec, sizeof(spec), "%s", replicas_spec);
+    for (char* token = strtok_r(spec, ", ", &saveptr); token; token = strtok_r(NULL, ", ", &saveptr)) {
+        struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM }, *res, *ai;
+        if (getaddrinfo(token, NULL, &hints, &res) != 0) continue;
+        for (ai = res; ai && n < MAX_REPLICAS; ai = ai->ai_next) {
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &((struct sockaddr_in*)ai->ai_addr)->sin_addr, ip, sizeof(ip));
+            for (i = 0; i < n && strcmp(ips[i], ip) != 0; i++)
+                ;
+            if (i == n) strcpy(ips[n++], ip);
+        }
+        freeaddrinfo(res);
     }
     
-    response[bytes_received] = '\0';
+    pthread_mutex_lock(&replicas_mutex);
+    for (k = 0; k < num_replicas; k++) {
+        replicas[k].present = 0;
+        for (i = 0; i < n; i++)
+            if (strcmp(replicas[k].host, ips[i]) == 0) {
+                replicas[k].present = 1;
+                ips[i][0] = '\0';
+            }
+    }
+    for (i = 0; i < n; i++) {
+        if (!ips[i][0]) continue;
+        replica_t* r = NULL;
+        for (k = 0; k < num_replicas && !r; k++) {
+            pthread_mutex_lock(&replicas[k].engine.mutex);
+            if (!replicas[k].present && replicas[k].engine.outstanding == 0) {
+                // Slot reaproveitado: conexões e médias eram do pod antigo
+                while (replicas[k].engine.nidle > 0)
+                    close(replicas[k].engine.idle[--replicas[k].engine.nidle].fd);
+                r = &replicas[k];
+            }
+            pthread_mutex_unlock(&replicas[k].engine.mutex);
+        }
+        if (!r && num_replicas < MAX_REPLICAS) {
+            r = &replicas[num_replicas++];
+            pthread_mutex_init(&r->engine.mutex, NULL);
+        }
+        if (!r) break;
+        pthread_mutex_lock(&r->engine.mutex);
+        snprintf(r->host, sizeof(r->host), "%s", ips[i]);
+        snprintf(r->name, sizeof(r->name), "openmp@%s", ips[i]);
+        r->present = 1;
+        r->engine.name = r->name;
+        r->engine.host = r->host;
+        r->engine.port = engines[0].port;     // engines[0] é o Service do OpenMP
+        r->engine.async_jobs = 1;
+        r->engine.healthy = 0;          // até a primeira sondagem
+        r->engine.opened = r->engine.reused = 0;
+        memset(r->engine.ewma_size, 0, sizeof(r->engine.ewma_size));
+        // O p95 do hedge também era do pod anterior
+        memset(r->engine.latency, 0, sizeof(r->engine.latency));
+        memset(r->engine.latency_count, 0, sizeof(r->engine.latency_count));
+        r->engine.ewma_rate = engines[0].ewma_rate;
+        r->engine.ewma_overhead = engines[0].ewma_overhead;
+        pthread_mutex_unlock(&r->engine.mutex);
+        printf("Réplica %s adicionada ao scatter-gather\n", r->name);
+    }
+    pthread_mutex_unlock(&replicas_mutex);
+}
+
+// Thread de sondagem: tira da rota automática os engines que não
+// respondem e devolve os que voltaram
+void* health_prober(void* arg) {
+    (void)arg;
+    while (1) {
+        int k;
+        for (k = 0; k < NUM_ENGINES; k++) {
+            int ok = probe_engine(&engines[k]);
+            pthread_mutex_lock(&engines[k].mutex);
+            if (ok != engines[k].healthy)
+                printf("Roteador: engine %s agora %s\n", engines[k].name, ok ? "saudável" : "fora do ar");
+            engines[k].healthy = ok;
+            pthread_mutex_unlock(&engines[k].mutex);
+        }
+        // Réplicas para o scatter-gather; só esta thread acrescenta slots
+        int width = 0;
+        replicas_refresh();
+        for (k = 0; k < num_replicas; k++) {
+            engine_t* replica = &replicas[k].engine;
+            int ok = replicas[k].present && probe_engine(replica);
+            pthread_mutex_lock(&replica->mutex);
+            if (ok != replica->healthy && replicas[k].present)
+                printf("Roteador: réplica %s agora %s\n", replica->name, ok ? "saudável" : "fora do ar");
+            replica->healthy = ok;
+            pthread_mutex_unlock(&replica->mutex);
+            width += ok;
+        }
+        atomic_store(&scatter_width, width);
+        struct timespec pausa = { ROUTER_PROBE_INTERVAL_MS / 1000, (ROUTER_PROBE_INTERVAL_MS % 1000) * 1000000L };
+        nanosleep(&pausa, NULL);
+    }
+    return NULL;
+}
+
+// Procura um pedido idêntico em andamento (mesmo intervalo e, se o cliente
+// escolheu o engine, o mesmo engine); achando, entra nele como seguidor.
+// Senão escolhe o engine (rota automática quando engine == NULL) e
+// registra um pedido novo tendo este cliente como líder. A tabela fica
+// travada durante a escolha para que dois pedidos iguais não virem dois
+// líderes.
+flight_t* flight_acquire(int powmin, int powmax, engine_t* engine, int client_socket,
+                         int request_id, int* leader, double* estimate,
+                         char* routing, size_t routing_size) {
+    flight_t* flight;
     
-    // Encontrar o JSON na resposta (após headers HTTP)
-    char* json_start = strstr(response, "\r\n\r\n");
-    if (json_start) {
-        json_start += 4; // Pular \r\n\r\n
-        strncpy(response_buffer, json_start, buffer_size - 1);
-        response_buffer[buffer_size - 1] = '\0';
-        return 1;
+    pthread_mutex_lock(&flights_mutex);
+    for (flight = flights; flight; flight = flight->next) {
+        if (flight->powmin == powmin && flight->powmax == powmax &&
+            (!engine || flight->engine == engine)) {
+            pthread_mutex_lock(&flight->mutex);
+            flight->refs++;
+            pthread_mutex_unlock(&flight->mutex);
+            coalesced_requests++;
+            pthread_mutex_unlock(&flights_mutex);
+            *leader = 0;
+            *estimate = 0.0;
+            snprintf(routing, routing_size,
+                     "{\"policy\":\"coalesced\",\"chosen\":\"%s\",\"leader_request\":%d}",
+                     flight->engine->name, flight->leader_id);
+            return flight;
+        }
+    }
+    
+    flight = calloc(1, sizeof(flight_t));
+    if (!flight) {
+        pthread_mutex_unlock(&flights_mutex);
+        return NULL;
+    }
+    if (engine) {
+        pthread_mutex_lock(&engine->mutex);
+        *estimate = estimate_locked(engine, powmin, powmax);
+        pthread_mutex_unlock(&engine->mutex);
+        snprintf(routing, routing_size, "{\"policy\":\"explicit\",\"chosen\":\"%s\",\"estimate\":%.6f}",
+                 engine->name, *estimate);
     } else {
-        snprintf(response_buffer, buffer_size, "ERRO: Resposta inválida do engine");
-        return 0;
+        // Se não especificado ou "auto", menor tempo esperado de conclusão
+        engine = route_request(powmin, powmax, estimate, routing, routing_size);
+    }
+    flight->powmin = powmin;
+    flight->powmax = powmax;
+    flight->engine = engine;
+    flight->leader_socket = client_socket;
+    flight->leader_id = request_id;
+    flight->refs = 1;
+    pthread_mutex_init(&flight->mutex, NULL);
+    pthread_cond_init(&flight->cond, NULL);
+    flight->next = flights;
+    flights = flight;
+    pthread_mutex_unlock(&flights_mutex);
+    *leader = 1;
+    return flight;
+}
+
+// Fim da chamada do líder: tira o pedido da tabela (novos pedidos iguais
+// passam a gerar nova chamada) e acorda os seguidores
+void flight_finish(flight_t* flight, int success, const char* error) {
+    flight_t** p;
+    
+    pthread_mutex_lock(&flights_mutex);
+    for (p = &flights; *p; p = &(*p)->next) {
+        if (*p == flight) {
+            *p = flight->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&flights_mutex);
+    
+    pthread_mutex_lock(&flight->mutex);
+    flight->done = 1;
+    flight->success = success;
+    snprintf(flight->error, sizeof(flight->error), "%s", error ? error : "");
+    pthread_cond_broadcast(&flight->cond);
+    pthread_mutex_unlock(&flight->mutex);
+}
+
+// Seguidor: repassa ao seu cliente a saída do líder desde o início, à
+// medida que ela chega, até a chamada terminar ou o seu próprio prazo
+// (call_deadline) acabar; o líder segue com o prazo dele
+int flight_follow(flight_t* flight, int client_socket, char* error_buffer, int buffer_size) {
+    size_t sent = 0;
+    
+    pthread_mutex_lock(&flight->mutex);
+    while (1) {
+        while (sent < flight->len) {
+            // Copia fora do mutex: o buffer pode ser realocado pelo líder
+            size_t n = flight->len - sent;
+            char chunk[BUFFER_SIZE];
+            if (n > sizeof(chunk)) n = sizeof(chunk);
+            memcpy(chunk, flight->out + sent, n);
+            pthread_mutex_unlock(&flight->mutex);
+            send_all(client_socket, chunk, n);
+            sent += n;
+            pthread_mutex_lock(&flight->mutex);
+        }
+        if (flight->done) break;
+        if (call_deadline > 0) {
+            // O prazo do seguidor pode ser menor que o do líder
+            struct timespec ts = { call_deadline / 1000, (call_deadline % 1000) * 1000000L };
+            if (pthread_cond_timedwait(&flight->cond, &flight->mutex, &ts) == ETIMEDOUT &&
+                !flight->done && sent == flight->len) {
+                pthread_mutex_unlock(&flight->mutex);
+                metrics_add(prom.deadline_exceeded, 1);
+                snprintf(error_buffer, buffer_size, "ERRO: Prazo esgotado aguardando o pedido do cliente %d",
+                         flight->leader_id);
+                return 0;
+            }
+        } else {
+            pthread_cond_wait(&flight->cond, &flight->mutex);
+        }
     }
+    int success = flight->success;
+    snprintf(error_buffer, buffer_size, "%s", flight->error);
+    pthread_mutex_unlock(&flight->mutex);
+    return success;
+}
+
+void flight_release(flight_t* flight) {
+    pthread_mutex_lock(&flight->mutex);
+    int refs = --flight->refs;
+    pthread_mutex_unlock(&flight->mutex);
+    if (refs > 0) return;
+    pthread_mutex_destroy(&flight->mutex);
+    pthread_cond_destroy(&flight->cond);
+    free(flight->out);
+    free(flight);
+}
+
+// Resposta HTTP de /metrics: histogramas e contadores do módulo metrics
+// mais os contadores já mantidos pelo servidor (clientes, fila do ES, pools)
+void serve_metrics(int sock) {
+    size_t len, cap;
+    char* text = metrics_render(&len, &cap);
+    char headers[256];
+    int k;
+
+    pthread_mutex_lock(&stats_mutex);
+    int active = active_clients, total = total_requests;
+    pthread_mutex_unlock(&stats_mutex);
+    metrics_appendf(&text, &len, &cap,
+            "# TYPE socket_active_clients gauge\nsocket_active_clients %d\n"
+            "# TYPE socket_clients_total counter\nsocket_clients_total %d\n"
+            "# TYPE socket_es_docs_total counter\n"
+            "socket_es_docs_total{state=\"enqueued\"} %lu\n"
+            "socket_es_docs_total{state=\"dropped\"} %lu\n"
+            "socket_es_docs_total{state=\"sent\"} %lu\n"
+            "socket_es_docs_total{state=\"failed\"} %lu\n"
+            "# TYPE socket_es_batches_total counter\nsocket_es_batches_total %lu\n",
+            active, total,
+            atomic_load(&metrics_ring.enqueued), atomic_load(&metrics_ring.dropped),
+            atomic_load(&metrics_ring.sent), atomic_load(&metrics_ring.failed),
+            atomic_load(&metrics_ring.batches));
+    // Cada família com suas amostras juntas, como o formato exige
+    int healthy[NUM_ENGINES], outstanding[NUM_ENGINES];
+    unsigned long opened[NUM_ENGINES], reused[NUM_ENGINES];
+    for (k = 0; k < NUM_ENGINES; k++) {
+        pthread_mutex_lock(&engines[k].mutex);
+        healthy[k] = engines[k].healthy;
+        outstanding[k] = engines[k].outstanding;
+        opened[k] = engines[k].opened;
+        reused[k] = engines[k].reused;
+        pthread_mutex_unlock(&engines[k].mutex);
+    }
+    metrics_appendf(&text, &len, &cap, "# TYPE socket_engine_healthy gauge\n");
+    for (k = 0; k < NUM_ENGINES; k++)
+        metrics_appendf(&text, &len, &cap, "socket_engine_healthy{engine=\"%s\"} %d\n",
+                        engines[k].name, healthy[k]);
+    metrics_appendf(&text, &len, &cap, "# TYPE socket_engine_outstanding gauge\n");
+    for (k = 0; k < NUM_ENGINES; k++)
+        metrics_appendf(&text, &len, &cap, "socket_engine_outstanding{engine=\"%s\"} %d\n",
+                        engines[k].name, outstanding[k]);
+    metrics_appendf(&text, &len, &cap, "# TYPE socket_pool_connections_total counter\n");
+    for (k = 0; k < NUM_ENGINES; k++)
+        metrics_appendf(&text, &len, &cap,
+                "socket_pool_connections_total{engine=\"%s\",kind=\"opened\"} %lu\n"
+                "socket_pool_connections_total{engine=\"%s\",kind=\"reused\"} %lu\n",
+                engines[k].name, opened[k], engines[k].name, reused[k]);
+    // Réplicas do scatter-gather, rotuladas pelo IP do pod
+    metrics_appendf(&text, &len, &cap, "# TYPE socket_replica_healthy gauge\n");
+    pthread_mutex_lock(&replicas_mutex);
+    for (k = 0; k < num_replicas; k++) {
+        pthread_mutex_lock(&replicas[k].engine.mutex);
+        if (replicas[k].present)
+            metrics_appendf(&text, &len, &cap, "socket_replica_healthy{replica=\"%s\"} %d\n",
+                            replicas[k].host, replicas[k].engine.healthy);
+        pthread_mutex_unlock(&replicas[k].engine.mutex);
+    }
+    pthread_mutex_unlock(&replicas_mutex);
+
+    int n = snprintf(headers, sizeof(headers),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Content-Length: %zu\r\n"
+            "Connection: close\r\n"
+            "\r\n", text ? len : 0);
+    send_all(sock, headers, n);
+    if (text) send_all(sock, text, len);
+    free(text);
 }
 
 void* handle_client(void* arg) {
@@ -217,6 +1996,21 @@ void* handle_client(void* arg) {
     // Obter IP do cliente
     strcpy(client_ip, inet_ntoa(client->address.sin_addr));
     
+    // Timestamp início do processamento
+    long long start_time = get_timestamp_ms();
+    
+    // Receber dados do cliente
+    ssize_t bytes_received = recv(client->socket, buffer, BUFFER_SIZE - 1, 0);
+    if (bytes_received > 0) buffer[bytes_received] = '\0';
+    
+    // Scrape do Prometheus na mesma porta; não conta como cliente
+    if (bytes_received > 0 && strncmp(buffer, "GET /metrics", 12) == 0) {
+        serve_metrics(client->socket);
+        close(client->socket);
+        free(client);
+        return NULL;
+    }
+    
     // Incrementar contador de clientes ativos
     pthread_mutex_lock(&stats_mutex);
     active_clients++;
@@ -224,110 +2018,148 @@ void* handle_client(void* arg) {
     int request_id = total_requests;
     pthread_mutex_unlock(&stats_mutex);
     
-    // Timestamp início do processamento
-    long long start_time = get_timestamp_ms();
-    
     printf("Cliente %d conectado de %s\n", request_id, client_ip);
     
-    // Receber dados do cliente
-    ssize_t bytes_received = recv(client->socket, buffer, BUFFER_SIZE - 1, 0);
     if (bytes_received <= 0) {
         printf("Erro ao receber dados do cliente %d\n", request_id);
         goto cleanup;
     }
     
-    buffer[bytes_received] = '\0';
     printf("Cliente %d enviou: %s\n", request_id, buffer);
     
-    // Parsear POWMIN, POWMAX e ENGINE
+    // Parsear POWMIN, POWMAX, ENGINE e o prazo opcional (segundos)
     int powmin, powmax;
     char engine_type[32] = "auto";
+    double deadline = 0.0;
     
-    int parsed = sscanf(buffer, "%d %d %s", &powmin, &powmax, engine_type);
+    int parsed = sscanf(buffer, "%d %d %31s %lf", &powmin, &powmax, engine_type, &deadline);
     if (parsed < 2) {
         const char* error_msg = "Formato inválido de entrada";
-        send_metrics_to_elasticsearch("unknown", 0, 0, request_id, 0, 0.0, client_ip, error_msg);
+        metrics_add(prom.invalid, 1);
+        send_metrics_to_elasticsearch("unknown", 0, 0, request_id, 0, 0.0, client_ip, error_msg, NULL, 0, 0.0);
         
-        strcpy(response, "ERRO: Formato inválido. Use: <POWMIN> <POWMAX> [engine]\n"
-                        "Exemplo: 3 6 spark\n"
+        strcpy(response, "ERRO: Formato inválido. Use: <POWMIN> <POWMAX> [engine] [prazo_s]\n"
+                        "Exemplo: 3 6 spark 30\n"
                         "Engines disponíveis: openmp, spark, auto");
         send(client->socket, response, strlen(response), 0);
         goto cleanup;
     }
     
     // Validar parâmetros
-    if (powmin < 3 || powmax > 15 || powmin > powmax) {
+    if (powmin < 3 || powmax > ROUTER_MAX_POW || powmin > powmax) {
         const char* error_msg = "Parâmetros inválidos";
-        send_metrics_to_elasticsearch(engine_type, powmin, powmax, request_id, 0, 0.0, client_ip, error_msg);
+        metrics_add(prom.invalid, 1);
+        send_metrics_to_elasticsearch(engine_type, powmin, powmax, request_id, 0, 0.0, client_ip, error_msg, NULL, 0, 0.0);
         
         strcpy(response, "ERRO: POWMIN deve estar entre 3-15 e POWMIN <= POWMAX");
         send(client->socket, response, strlen(response), 0);
         goto cleanup;
     }
     
+    // Sem prazo do cliente: custo fixo mais o trabalho do intervalo a uma
+    // taxa mínima aceitável. Vencido o prazo, o job é cancelado no engine.
+    if (deadline <= 0.0) {
+        int pow;
+        deadline = deadline_base;
+        for (pow = powmin; pow <= powmax; pow++)
+            deadline += size_cost(pow) / deadline_min_rate;
+    }
+    call_deadline = start_time + (long long)(deadline * 1000.0);
+    
     // Determinar qual engine usar - USANDO IPs DIRETOS
-    const char* service_host;
-    int service_port;
-    
-    if (strcmp(engine_type, "openmp") == 0) {
-        service_host = "10.108.84.193";  // IP do openmpmpi-service
-        service_port = 8081;
-    } else if (strcmp(engine_type, "spark") == 0) {
-        service_host = "10.101.15.95";   // IP do spark-service
-        service_port = 8082;
-    } else {
-        // Se não especificado ou "auto", alternar entre engines (round-robin)
-        static int engine_counter = 0;
-        if ((engine_counter++ % 2) == 0) {
-            service_host = "10.108.84.193";  // IP do openmpmpi-service
-            service_port = 8081;
-            strcpy(engine_type, "openmp");
-        } else {
-            service_host = "10.101.15.95";   // IP do spark-service
-            service_port = 8082;
-            strcpy(engine_type, "spark");
-        }
+    engine_t* engine = NULL;
+    char routing[1024];
+    double estimate = 0.0;
+    int k, leader;
+    
+    for (k = 0; k < NUM_ENGINES; k++)
+        if (strcmp(engine_type, engines[k].name) == 0)
+            engine = &engines[k];
+    
+    flight_t* flight = flight_acquire(powmin, powmax, engine, client->socket, request_id,
+                                      &leader, &estimate, routing, sizeof(routing));
+    if (!flight) {
+        strcpy(response, "ERRO: Falta de memória no servidor");
+        send_all(client->socket, response, strlen(response));
+        goto cleanup;
     }
+    engine = flight->engine;
+    strcpy(engine_type, engine->name);
+    
+    if (leader)
+        printf("Cliente %d: Redirecionando para engine %s (%s:%d) - POWMIN=%d, POWMAX=%d, estimativa=%.3fs\n", 
+               request_id, engine_type, engine->host, engine->port, powmin, powmax, estimate);
+    else
+        printf("Cliente %d: Pedido idêntico ao do cliente %d em andamento no engine %s; aguardando o resultado\n",
+               request_id, flight->leader_id, engine_type);
     
-    printf("Cliente %d: Redirecionando para engine %s (%s:%d) - POWMIN=%d, POWMAX=%d\n", 
-           request_id, engine_type, service_host, service_port, powmin, powmax);
+    // O cabeçalho do relatório vai antes: os resultados de cada tamanho
+    // são repassados ao cliente conforme o engine os envia
+    snprintf(response, BUFFER_SIZE,
+            "=== PSPD - Resultado do Processamento ===\n"
+            "Engine: %s\n"
+            "POWMIN: %d, POWMAX: %d\n"
+            "Request ID: %d\n\n"
+            "Detalhes:\n",
+            engine_type, powmin, powmax, request_id);
+    send_all(client->socket, response, strlen(response));
     
-    // Chamar engine apropriado
-    int success = call_engine_http(service_host, service_port, "/process", 
-                                  powmin, powmax, engine_response, sizeof(engine_response));
+    // Chamar engine apropriado, ou acompanhar a chamada do líder
+    int success;
+    if (leader) {
+        double size_time[ROUTER_MAX_POW + 1] = { 0 };
+        // Com duas réplicas ou mais, até um tam só vai por elas: é o que
+        // permite a duplicata (hedge) quando uma réplica demora
+        int scatter = engine->scatter && atomic_load(&scatter_width) >= 2;
+        router_begin(engine, estimate);
+        long long call_start = get_timestamp_ms();
+        if (scatter) {
+            metrics_add(prom.scattered, 1);
+            success = call_engine_scatter(powmin, powmax, flight, size_time, routing, sizeof(routing),
+                                          engine_response, sizeof(engine_response));
+        } else if (engine->async_jobs)
+            success = call_engine_job(engine, powmin, powmax, flight,
+                                      size_time, engine_response, sizeof(engine_response));
+        else
+            success = call_engine_http(engine, "/process", powmin, powmax, flight,
+                                       size_time, engine_response, sizeof(engine_response));
+        double call_time = (get_timestamp_ms() - call_start) / 1000.0;
+        // No scatter as médias por tam ficam com as réplicas (atualizadas
+        // pelos workers); do Service só sai a estimativa em andamento
+        router_end(engine, estimate, powmin, powmax, call_time, size_time, success && !scatter);
+        metrics_observe(engine->upstream_time, call_time);
+        flight_finish(flight, success, success ? NULL : engine_response);
+    } else {
+        success = flight_follow(flight, client->socket, engine_response, sizeof(engine_response));
+        metrics_add(prom.coalesced, 1);
+    }
+    flight_release(flight);
     
     // Calcular tempo de processamento
     long long end_time = get_timestamp_ms();
     double processing_time = (end_time - start_time) / 1000.0; // em segundos
+    metrics_add(success ? prom.ok : prom.failed, 1);
+    metrics_observe(success ? prom.time_ok : prom.time_failed, processing_time);
     
     // Enviar métricas para ElasticSearch
     send_metrics_to_elasticsearch(engine_type, powmin, powmax, request_id, success, 
-                                 processing_time, client_ip, success ? NULL : engine_response);
+                                 processing_time, client_ip, success ? NULL : engine_response,
+                                 routing, !leader, deadline);
     
     if (success) {
         snprintf(response, BUFFER_SIZE, 
-                "=== PSPD - Resultado do Processamento ===\n"
-                "Engine: %s\n"
-                "POWMIN: %d, POWMAX: %d\n"
-                "Request ID: %d\n"
-                "Status: SUCESSO\n\n"
-                "Detalhes:\n%s\n"
-                "=========================================",
-                engine_type, powmin, powmax, request_id, engine_response);
+                "\nStatus: SUCESSO\n"
+                "=========================================");
     } else {
         snprintf(response, BUFFER_SIZE,
-                "=== PSPD - Erro no Processamento ===\n"
-                "Engine: %s\n"
-                "POWMIN: %d, POWMAX: %d\n"
-                "Request ID: %d\n"
-                "Status: FALHA\n\n"
+                "\nStatus: FALHA\n"
                 "Erro: %s\n"
-                "===================================",
-                engine_type, powmin, powmax, request_id, engine_response);
+                "=========================================",
+                engine_response);
     }
     
-    // Enviar resposta para cliente
-    send(client->socket, response, strlen(response), 0);
+    // Enviar rodapé para cliente
+    send_all(client->socket, response, strlen(response));
     
     printf("Cliente %d: Processamento finalizado (%s) - %.3fs\n", 
            request_id, success ? "SUCESSO" : "FALHA", processing_time);
@@ -350,7 +2182,34 @@ int main() {
     pthread_t thread_id;
     
     printf("Inicializando Socket Server HTTP na porta %d...\n", PORT);
-    printf("ElasticSearch configurado para: %s:%d\n", ELASTICSEARCH_HOST, ELASTICSEARCH_PORT);
+    if (getenv("ELASTICSEARCH_HOST")) elasticsearch_host = getenv("ELASTICSEARCH_HOST");
+    if (getenv("ELASTICSEARCH_PORT")) elasticsearch_port = atoi(getenv("ELASTICSEARCH_PORT"));
+    if (getenv("ELASTICSEARCH_INDEX")) elasticsearch_index = getenv("ELASTICSEARCH_INDEX");
+    replicas_spec = getenv("OPENMP_REPLICAS");
+    if (getenv("DEADLINE_BASE_S") && atof(getenv("DEADLINE_BASE_S")) > 0.0)
+        deadline_base = atof(getenv("DEADLINE_BASE_S"));
+    if (getenv("DEADLINE_MIN_RATE") && atof(getenv("DEADLINE_MIN_RATE")) > 0.0)
+        deadline_min_rate = atof(getenv("DEADLINE_MIN_RATE"));
+    printf("ElasticSearch configurado para: %s:%d (índice %s, envio em lotes _bulk)\n",
+           elasticsearch_host, elasticsearch_port, elasticsearch_index);
+    printf("Prazo padrão: %.1fs + custo/%.3g; hedge após o p95 de cada réplica\n",
+           deadline_base, deadline_min_rate);
+    
+    // Shipper de métricas em segundo plano
+    register_metrics();
+    metrics_ring_init();
+    if (pthread_create(&thread_id, NULL, metrics_shipper, NULL) != 0) {
+        perror("Erro ao criar shipper de métricas");
+        exit(1);
+    }
+    pthread_detach(thread_id);
+    
+    // Sondagem periódica de /health dos engines
+    if (pthread_create(&thread_id, NULL, health_prober, NULL) != 0) {
+        perror("Erro ao criar sondagem dos engines");
+        exit(1);
+    }
+    pthread_detach(thread_id);
     
     // Criar socket
     server_socket = socket(AF_INET, SOCK_STREAM, 0);
@@ -385,10 +2244,14 @@ int main() {
     
     printf("Socket Server aguardando conexões na porta %d...\n", PORT);
     printf("Engines disponíveis:\n");
-    printf("  OpenMP: 10.108.84.193:8081\n");
-    printf("  Spark:  10.101.15.95:8082\n");
+    for (int k = 0; k < NUM_ENGINES; k++)
+        printf("  %s: %s:%d (pool de até %d conexões keep-alive)\n",
+               engines[k].name, engines[k].host, engines[k].port, POOL_MAX_IDLE);
+    if (replicas_spec)
+        printf("  réplicas do openmp para scatter-gather: %s (até %d)\n", replicas_spec, MAX_REPLICAS);
     printf("\nFormato de entrada: <POWMIN> <POWMAX> [engine]\n");
-    printf("Exemplo: 3 6 spark\n\n");
+    printf("Exemplo: 3 6 spark\n");
+    printf("Métricas Prometheus: GET /metrics na mesma porta\n\n");
     
     // Loop principal - aceitar conexões
     while (1) {